@@ -3,8 +3,22 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 
+/* Number of buckets in each block device histogram.  Bucket 0
+   counts the value 0, bucket I > 0 counts values in the range
+   [2**(I-1), 2**I), and the last bucket also absorbs anything
+   larger. */
+#define BLOCK_HIST_CNT 16
+
+/* A log2 histogram. */
+struct block_hist
+  {
+    unsigned long long buckets[BLOCK_HIST_CNT];
+  };
+
 /* A block device. */
 struct block
   {
@@ -19,6 +33,17 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+    unsigned long long flush_cnt;       /* Number of cache flushes. */
+
+    /* Request statistics, updated with interrupts off. */
+    unsigned long long req_cnt;         /* Number of requests. */
+    unsigned long long seq_cnt;         /* Requests that continued the
+                                           previous one. */
+    block_sector_t next_sector;         /* Sector after the last request. */
+    int in_flight;                      /* Requests now in the driver. */
+    struct block_hist latency;          /* Request latency, in microseconds. */
+    struct block_hist depth;            /* In-flight requests at issue. */
+    struct block_hist req_size;         /* Request size, in sectors. */
   };
 
 /* List of all block devices. */
@@ -28,6 +53,9 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static int64_t stats_begin (struct block *, block_sector_t, size_t cnt);
+static void stats_end (struct block *, int64_t start);
+static void print_hist (const char *title, const struct block_hist *);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -120,11 +148,46 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
+  int64_t start;
+
   check_sector (block, sector);
+  start = stats_begin (block, sector, 1);
   block->ops->read (block->aux, sector, buffer);
+  stats_end (block, start);
   block->read_cnt++;
 }
 
+/* Reads CNT consecutive sectors starting at SECTOR from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Uses a single driver request if the driver supports
+   it, which is much cheaper than CNT separate calls to
+   block_read() on devices with a high per-command cost. */
+void
+block_read_multiple (struct block *block, block_sector_t sector, size_t cnt,
+                     void *buffer)
+{
+  int64_t start;
+
+  if (cnt == 0)
+    return;
+  check_sector (block, sector);
+  check_sector (block, sector + cnt - 1);
+  start = stats_begin (block, sector, cnt);
+  if (block->ops->read_multiple != NULL)
+    block->ops->read_multiple (block->aux, sector, cnt, buffer);
+  else
+    {
+      uint8_t *p = buffer;
+      size_t i;
+
+      for (i = 0; i < cnt; i++)
+        block->ops->read (block->aux, sector + i,
+                          p + i * BLOCK_SECTOR_SIZE);
+    }
+  stats_end (block, start);
+  block->read_cnt += cnt;
+}
+
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
    BLOCK_SECTOR_SIZE bytes.  Returns after the block device has
    acknowledged receiving the data.
@@ -133,12 +196,31 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
+  int64_t start;
+
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
+  start = stats_begin (block, sector, 1);
   block->ops->write (block->aux, sector, buffer);
+  stats_end (block, start);
   block->write_cnt++;
 }
 
+/* Waits until all writes to BLOCK that have already returned
+   are on stable storage, by asking the device to flush its write
+   cache.  block_write() alone only guarantees that the device has
+   received the data, which a drive with write caching enabled may
+   still lose on power failure.  Does nothing for devices without
+   a write cache. */
+void
+block_flush (struct block *block)
+{
+  if (block->ops->flush == NULL)
+    return;
+  block->ops->flush (block->aux);
+  block->flush_cnt++;
+}
+
 /* Returns the number of sectors in BLOCK. */
 block_sector_t
 block_size (struct block *block)
@@ -171,13 +253,53 @@ block_print_stats (void)
       struct block *block = block_by_role[i];
       if (block != NULL)
         {
-          printf ("%s (%s): %llu reads, %llu writes\n",
+          printf ("%s (%s): %llu reads, %llu writes, %llu flushes\n",
                   block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
+                  block->read_cnt, block->write_cnt, block->flush_cnt);
         }
     }
 }
 
+/* Prints the request histograms of every registered block
+   device.  May be called at any time, not just at shutdown. */
+void
+block_print_histograms (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_blocks); e != list_end (&all_blocks);
+       e = list_next (e))
+    {
+      struct block *block = list_entry (e, struct block, list_elem);
+      struct block *copy;
+      unsigned long long requests;
+      enum intr_level old_level;
+
+      /* Take a consistent snapshot so that requests completing
+         while we print do not skew the numbers. */
+      copy = malloc (sizeof *copy);
+      if (copy == NULL)
+        return;
+      old_level = intr_disable ();
+      *copy = *block;
+      intr_set_level (old_level);
+
+      requests = copy->req_cnt;
+      printf ("%s (%s): %llu reads, %llu writes, %llu requests, "
+              "%llu sequential (%llu%%)\n",
+              copy->name, block_type_name (copy->type),
+              copy->read_cnt, copy->write_cnt, requests, copy->seq_cnt,
+              requests != 0 ? copy->seq_cnt * 100 / requests : 0);
+      if (requests != 0)
+        {
+          print_hist ("latency (us)", &copy->latency);
+          print_hist ("queue depth", &copy->depth);
+          print_hist ("request size (sectors)", &copy->req_size);
+        }
+      free (copy);
+    }
+}
+
 /* Registers a new block device with the given NAME.  If
    EXTRA_INFO is non-null, it is printed as part of a user
    message.  The block device's SIZE in sectors and its TYPE must
@@ -200,6 +322,14 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  block->flush_cnt = 0;
+  block->req_cnt = 0;
+  block->seq_cnt = 0;
+  block->next_sector = 0;
+  block->in_flight = 0;
+  memset (&block->latency, 0, sizeof block->latency);
+  memset (&block->depth, 0, sizeof block->depth);
+  memset (&block->req_size, 0, sizeof block->req_size);
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -221,3 +351,73 @@ list_elem_to_block (struct list_elem *list_elem)
           : NULL);
 }
 
+
+/* Adds VALUE to histogram H. */
+static void
+hist_add (struct block_hist *h, unsigned long long value)
+{
+  int bucket = 0;
+
+  while (value != 0 && bucket < BLOCK_HIST_CNT - 1)
+    {
+      value >>= 1;
+      bucket++;
+    }
+  h->buckets[bucket]++;
+}
+
+/* Records the start of a CNT-sector request to BLOCK at SECTOR.
+   Returns the time at which the request started, to be
+   passed to stats_end() once the driver returns. */
+static int64_t
+stats_begin (struct block *block, block_sector_t sector, size_t cnt)
+{
+  enum intr_level old_level = intr_disable ();
+
+  block->req_cnt++;
+  if (sector == block->next_sector)
+    block->seq_cnt++;
+  block->next_sector = sector + cnt;
+  hist_add (&block->depth, ++block->in_flight);
+  hist_add (&block->req_size, cnt);
+  intr_set_level (old_level);
+
+  return timer_ns ();
+}
+
+/* Records the completion of a request to BLOCK that started at
+   time START, as returned by timer_ns(). */
+static void
+stats_end (struct block *block, int64_t start)
+{
+  int64_t elapsed = (timer_ns () - start) / 1000;
+  enum intr_level old_level = intr_disable ();
+
+  block->in_flight--;
+  hist_add (&block->latency, elapsed);
+  intr_set_level (old_level);
+}
+
+/* Prints the nonempty buckets of H on one line, preceded by
+   TITLE. */
+static void
+print_hist (const char *title, const struct block_hist *h)
+{
+  int i;
+
+  printf ("  %s:", title);
+  for (i = 0; i < BLOCK_HIST_CNT; i++)
+    if (h->buckets[i] != 0)
+      {
+        if (i == 0)
+          printf (" [0] %llu", h->buckets[i]);
+        else if (i == 1)
+          printf (" [1] %llu", h->buckets[i]);
+        else if (i == BLOCK_HIST_CNT - 1)
+          printf (" [%llu+] %llu", 1ULL << (i - 1), h->buckets[i]);
+        else
+          printf (" [%llu-%llu] %llu",
+                  1ULL << (i - 1), (1ULL << i) - 1, h->buckets[i]);
+      }
+  printf ("\n");
+}
@@ -52,12 +52,15 @@ struct block *block_next (struct block *);
 /* Block device operations. */
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
+void block_read_multiple (struct block *, block_sector_t, size_t cnt, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_flush (struct block *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
 /* Statistics. */
 void block_print_stats (void);
+void block_print_histograms (void);
 
 /* Lower-level interface to block device drivers. */
 
@@ -65,6 +68,17 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Optional.  Reads CNT consecutive sectors into BUFFER in as
+       few device commands as the driver can manage.  If null, the
+       block layer falls back to calling read() once per sector. */
+    void (*read_multiple) (void *aux, block_sector_t, size_t cnt,
+                           void *buffer);
+
+    /* Optional.  Returns once every write the driver has already
+       acknowledged is on stable storage.  Null for devices with
+       no volatile write cache. */
+    void (*flush) (void *aux);
   };
 
 struct block *block_register (const char *name, enum block_type,
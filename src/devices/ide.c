@@ -11,7 +11,8 @@
 #include "threads/synch.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3], plus the 48-bit
+   address feature set from [ATA-6] for disks that support it. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -21,6 +22,11 @@
 #define reg_lbam(CHANNEL) ((CHANNEL)->reg_base + 4)     /* LBA 15:8. */
 #define reg_lbah(CHANNEL) ((CHANNEL)->reg_base + 5)     /* LBA 23:16. */
 #define reg_device(CHANNEL) ((CHANNEL)->reg_base + 6)   /* Device/LBA 27:24. */
+
+/* In 48-bit mode, the Sector Count and LBA registers are FIFOs
+   two bytes deep: the first write supplies the high-order byte
+   (sector count 15:8, LBA 31:24, 39:32, 47:40) and the second
+   write the low-order byte. */
 #define reg_status(CHANNEL) ((CHANNEL)->reg_base + 7)   /* Status (r/o). */
 #define reg_command(CHANNEL) reg_status (CHANNEL)       /* Command (w/o). */
 
@@ -34,6 +40,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +56,20 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_SECTOR_EXT 0x24        /* READ SECTOR EXT (48-bit). */
+#define CMD_WRITE_SECTOR_EXT 0x34       /* WRITE SECTOR EXT (48-bit). */
+#define CMD_FLUSH_CACHE 0xe7            /* FLUSH CACHE. */
+#define CMD_FLUSH_CACHE_EXT 0xea        /* FLUSH CACHE EXT (48-bit). */
+
+/* IDENTIFY DEVICE words that describe 48-bit addressing. */
+#define ID_CMD_SET_2 83                 /* Command sets supported. */
+#define ID_CMD_SET_2_LBA48 0x0400       /* 48-bit address feature set. */
+#define ID_LBA48_CAPACITY 100           /* Words 100...103: capacity. */
+
+/* Largest sector count for a single LBA28 or LBA48 command.  A
+   count register value of 0 means the maximum. */
+#define LBA28_MAX_SECTORS 256
+#define LBA48_MAX_SECTORS 65536
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +78,8 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    bool lba48;                 /* Supports 48-bit addressing? */
+    bool can_flush;             /* Accepts FLUSH CACHE? */
   };
 
 /* An ATA channel (aka controller).
@@ -81,11 +104,15 @@ static struct channel channels[CHANNEL_CNT];
 
 static struct block_operations ide_operations;
 
+/* -bigdisk: If true, register IDE disks of 1 GB or more instead
+   of ignoring them for safety. */
+bool ide_allow_big_disks;
+
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static bool select_sector (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -123,7 +150,7 @@ ide_init (void)
         default:
           NOT_REACHED ();
         }
-      lock_init (&c->lock);
+      lock_init_named (&c->lock, c->name);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
  
@@ -136,6 +163,8 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->lba48 = false;
+          d->can_flush = true;
         }
 
       /* Register interrupt handler. */
@@ -262,6 +291,7 @@ identify_ata_device (struct ata_disk *d)
   struct channel *c = d->channel;
   char id[BLOCK_SECTOR_SIZE];
   block_sector_t capacity;
+  const uint16_t *words = (const uint16_t *) id;
   char *model, *serial;
   char extra_info[128];
   struct block *block;
@@ -281,23 +311,37 @@ identify_ata_device (struct ata_disk *d)
     }
   input_sector (c, id);
 
-  /* Calculate capacity.
+  /* Calculate capacity.  Disks that support 48-bit addressing
+     report their full size in words 100...103; the 28-bit count
+     in words 60...61 saturates at 128 GB.  block_sector_t is 32
+     bits wide, so anything past 2 TB is out of reach and we
+     clamp to that.
      Read model name and serial number. */
   capacity = *(uint32_t *) &id[60 * 2];
+  if (words[ID_CMD_SET_2] & ID_CMD_SET_2_LBA48)
+    {
+      uint32_t lba48_lo = *(uint32_t *) &words[ID_LBA48_CAPACITY];
+      uint32_t lba48_hi = *(uint32_t *) &words[ID_LBA48_CAPACITY + 2];
+
+      d->lba48 = true;
+      capacity = lba48_hi != 0 ? UINT32_MAX : lba48_lo;
+    }
   model = descramble_ata_string (&id[10 * 2], 20);
   serial = descramble_ata_string (&id[27 * 2], 40);
   snprintf (extra_info, sizeof extra_info,
-            "model \"%s\", serial \"%s\"", model, serial);
+            "model \"%s\", serial \"%s\"%s", model, serial,
+            d->lba48 ? ", LBA48" : "");
 
   /* Disable access to IDE disks over 1 GB, which are likely
      physical IDE disks rather than virtual ones.  If we don't
      allow access to those, we're less likely to scribble on
-     someone's important data.  You can disable this check by
-     hand if you really want to do so. */
-  if (capacity >= 1024 * 1024 * 1024 / BLOCK_SECTOR_SIZE)
+     someone's important data.  The -bigdisk kernel option
+     disables this check for large disk images. */
+  if (capacity >= 1024 * 1024 * 1024 / BLOCK_SECTOR_SIZE
+      && !ide_allow_big_disks)
     {
       printf ("%s: ignoring ", d->name);
-      print_human_readable_size (capacity * 512);
+      print_human_readable_size ((uint64_t) capacity * 512);
       printf ("disk for safety\n");
       d->is_ata = false;
       return;
@@ -347,8 +391,8 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
+  issue_pio_command (c, (select_sector (d, sec_no, 1)
+                         ? CMD_READ_SECTOR_EXT : CMD_READ_SECTOR_RETRY));
   sema_down (&c->completion_wait);
   if (!wait_while_busy (d))
     PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
@@ -356,6 +400,45 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
   lock_release (&c->lock);
 }
 
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes.  Each
+   command transfers as many sectors as the addressing mode
+   allows.  The disk still interrupts once per sector, but device
+   selection and command setup are paid once per command instead
+   of once per sector.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read_multiple (void *d_, block_sector_t sec_no, size_t cnt, void *buffer)
+{
+  struct ata_disk *d = d_;
+  struct channel *c = d->channel;
+  uint8_t *p = buffer;
+
+  lock_acquire (&c->lock);
+  while (cnt > 0)
+    {
+      size_t max = d->lba48 ? LBA48_MAX_SECTORS : LBA28_MAX_SECTORS;
+      size_t chunk = cnt < max ? cnt : max;
+      size_t i;
+
+      issue_pio_command (c, (select_sector (d, sec_no, chunk)
+                             ? CMD_READ_SECTOR_EXT : CMD_READ_SECTOR_RETRY));
+      for (i = 0; i < chunk; i++)
+        {
+          sema_down (&c->completion_wait);
+          if (!wait_while_busy (d))
+            PANIC ("%s: disk read failed, sector=%"PRDSNu,
+                   d->name, sec_no + i);
+          input_sector (c, p);
+          p += BLOCK_SECTOR_SIZE;
+        }
+      sec_no += chunk;
+      cnt -= chunk;
+    }
+  lock_release (&c->lock);
+}
+
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
    BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
    acknowledged receiving the data.
@@ -367,8 +450,8 @@ ide_write (void *d_, block_sector_t sec_no, const void *buffer)
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
+  issue_pio_command (c, (select_sector (d, sec_no, 1)
+                         ? CMD_WRITE_SECTOR_EXT : CMD_WRITE_SECTOR_RETRY));
   if (!wait_while_busy (d))
     PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
   output_sector (c, buffer);
@@ -376,29 +459,87 @@ ide_write (void *d_, block_sector_t sec_no, const void *buffer)
   lock_release (&c->lock);
 }
 
+/* Flushes disk D's write cache, returning once all data that
+   ide_write() has handed to the disk is on the medium.
+   FLUSH CACHE is optional, and a disk without a write cache may
+   abort it, so an error means there is nothing to flush; after
+   the first one, we stop asking.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_flush (void *d_)
+{
+  struct ata_disk *d = d_;
+  struct channel *c = d->channel;
+  if (!d->can_flush)
+    return;
+  lock_acquire (&c->lock);
+  select_device_wait (d);
+  issue_pio_command (c, d->lba48 ? CMD_FLUSH_CACHE_EXT : CMD_FLUSH_CACHE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if (inb (reg_alt_status (c)) & STA_ERR)
+    {
+      printf ("%s: cache flush not supported, no longer flushing\n",
+              d->name);
+      d->can_flush = false;
+    }
+  lock_release (&c->lock);
+}
+
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_flush
   };
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
-static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+   writes SEC_NO and the sector count CNT to the disk's sector
+   selection registers.  (We use LBA mode.)
+
+   Requests that fit below the 28-bit limit use the classic
+   registers, since 48-bit commands cost an extra register write
+   per field.  Requests that reach past it require a disk that
+   supports 48-bit addressing.  Returns true if the caller must
+   issue the 48-bit ("EXT") form of its command. */
+static bool
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
+  uint8_t dev = DEV_MBS | DEV_LBA | (d->dev_no == 1 ? DEV_DEV : 0);
+
+  ASSERT (cnt > 0);
 
-  ASSERT (sec_no < (1UL << 28));
-  
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
-  outb (reg_lbal (c), sec_no);
-  outb (reg_lbam (c), sec_no >> 8);
-  outb (reg_lbah (c), (sec_no >> 16));
-  outb (reg_device (c),
-        DEV_MBS | DEV_LBA | (d->dev_no == 1 ? DEV_DEV : 0) | (sec_no >> 24));
+  if ((uint64_t) sec_no + cnt <= (1UL << 28) && cnt <= LBA28_MAX_SECTORS)
+    {
+      outb (reg_nsect (c), cnt);
+      outb (reg_lbal (c), sec_no);
+      outb (reg_lbam (c), sec_no >> 8);
+      outb (reg_lbah (c), (sec_no >> 16));
+      outb (reg_device (c), dev | (sec_no >> 24));
+      return false;
+    }
+  else
+    {
+      ASSERT (d->lba48);
+      ASSERT (cnt <= LBA48_MAX_SECTORS);
+
+      /* High-order bytes first.  block_sector_t has only 32 bits,
+         so LBA 47:32 are always zero. */
+      outb (reg_nsect (c), cnt >> 8);
+      outb (reg_lbal (c), sec_no >> 24);
+      outb (reg_lbam (c), 0);
+      outb (reg_lbah (c), 0);
+      outb (reg_nsect (c), cnt);
+      outb (reg_lbal (c), sec_no);
+      outb (reg_lbam (c), sec_no >> 8);
+      outb (reg_lbah (c), sec_no >> 16);
+      outb (reg_device (c), dev);
+      return true;
+    }
 }
 
 /* Writes COMMAND to channel C and prepares for receiving a
@@ -1,6 +1,10 @@
 #ifndef DEVICES_IDE_H
 #define DEVICES_IDE_H
 
+#include <stdbool.h>
+
 void ide_init (void);
 
+extern bool ide_allow_big_disks;
+
 #endif /* devices/ide.h */
@@ -13,9 +13,25 @@ struct partition
     block_sector_t start;               /* First sector within device. */
   };
 
+/* Number of sectors fetched per device read while scanning
+   partition tables.  Extended partition tables are often packed
+   close to the MBR or to one another, so reading a run of
+   sectors at once usually satisfies several tables with a single
+   device command. */
+#define SCAN_BATCH_SECTORS 16
+
+/* Sectors read ahead during a partition scan. */
+struct scan_cache
+  {
+    struct block *block;        /* Device being scanned. */
+    block_sector_t start;       /* First cached sector. */
+    size_t cnt;                 /* Number of cached sectors, 0 if none. */
+    uint8_t *data;              /* SCAN_BATCH_SECTORS sectors of data. */
+  };
+
 static struct block_operations partition_operations;
 
-static void read_partition_table (struct block *, block_sector_t sector,
+static void read_partition_table (struct scan_cache *, block_sector_t sector,
                                   block_sector_t primary_extended_sector,
                                   int *part_nr);
 static void found_partition (struct block *, uint8_t type,
@@ -27,10 +43,39 @@ static const char *partition_type_name (uint8_t);
 void
 partition_scan (struct block *block)
 {
+  struct scan_cache cache;
   int part_nr = 0;
-  read_partition_table (block, 0, 0, &part_nr);
+
+  cache.block = block;
+  cache.start = 0;
+  cache.cnt = 0;
+  cache.data = malloc (SCAN_BATCH_SECTORS * BLOCK_SECTOR_SIZE);
+  if (cache.data == NULL)
+    PANIC ("Failed to allocate memory for partition table.");
+
+  read_partition_table (&cache, 0, 0, &part_nr);
   if (part_nr == 0)
     printf ("%s: Device contains no partitions\n", block_name (block));
+
+  free (cache.data);
+}
+
+/* Returns the contents of SECTOR from the device that CACHE
+   scans, reading it and the sectors that follow it from the
+   device if it is not already cached.  The returned data is only
+   valid until the next call. */
+static const void *
+scan_cache_get (struct scan_cache *cache, block_sector_t sector)
+{
+  if (sector < cache->start || sector - cache->start >= cache->cnt)
+    {
+      block_sector_t left = block_size (cache->block) - sector;
+
+      cache->start = sector;
+      cache->cnt = left < SCAN_BATCH_SECTORS ? left : SCAN_BATCH_SECTORS;
+      block_read_multiple (cache->block, sector, cache->cnt, cache->data);
+    }
+  return cache->data + (sector - cache->start) * BLOCK_SECTOR_SIZE;
 }
 
 /* Reads the partition table in the given SECTOR of BLOCK and
@@ -45,12 +90,16 @@ partition_scan (struct block *block)
 
    PART_NR points to the number of non-empty primary or logical
    partitions already encountered on BLOCK.  It is incremented as
-   partitions are found. */
+   partitions are found.
+
+   Sectors are fetched through CACHE, which holds BLOCK. */
 static void
-read_partition_table (struct block *block, block_sector_t sector,
+read_partition_table (struct scan_cache *cache, block_sector_t sector,
                       block_sector_t primary_extended_sector,
                       int *part_nr)
 {
+  struct block *block = cache->block;
+
   /* Format of a partition table entry.  See [Partitions]. */
   struct partition_table_entry
     {
@@ -72,7 +121,8 @@ read_partition_table (struct block *block, block_sector_t sector,
     }
   PACKED;
 
-  struct partition_table *pt;
+  const struct partition_table *pt;
+  struct partition_table_entry entries[4];
   size_t i;
 
   /* Check SECTOR validity. */
@@ -85,10 +135,8 @@ read_partition_table (struct block *block, block_sector_t sector,
 
   /* Read sector. */
   ASSERT (sizeof *pt == BLOCK_SECTOR_SIZE);
-  pt = malloc (sizeof *pt);
-  if (pt == NULL)
-    PANIC ("Failed to allocate memory for partition table.");
-  block_read (block, 0, pt);
+  ASSERT (sizeof entries == sizeof pt->partitions);
+  pt = scan_cache_get (cache, sector);
 
   /* Check signature. */
   if (pt->signature != 0xaa55)
@@ -98,14 +146,15 @@ read_partition_table (struct block *block, block_sector_t sector,
       else
         printf ("%s: Invalid extended partition table in sector %"PRDSNu"\n",
                 block_name (block), sector);
-      free (pt);
       return;
     }
 
-  /* Parse partitions. */
-  for (i = 0; i < sizeof pt->partitions / sizeof *pt->partitions; i++)
+  /* Parse partitions.  Copy the entries out first, because the
+     recursive calls below may refill the cache. */
+  memcpy (entries, pt->partitions, sizeof entries);
+  for (i = 0; i < sizeof entries / sizeof *entries; i++)
     {
-      struct partition_table_entry *e = &pt->partitions[i];
+      struct partition_table_entry *e = &entries[i];
 
       if (e->size == 0 || e->type == 0)
         {
@@ -128,9 +177,9 @@ read_partition_table (struct block *block, block_sector_t sector,
              is nested, the offset is relative to the start of
              the extended partition that the MBR points to. */
           if (sector == 0)
-            read_partition_table (block, e->offset, e->offset, part_nr);
+            read_partition_table (cache, e->offset, e->offset, part_nr);
           else
-            read_partition_table (block, e->offset + primary_extended_sector,
+            read_partition_table (cache, e->offset + primary_extended_sector,
                                   primary_extended_sector, part_nr);
         }
       else
@@ -141,8 +190,6 @@ read_partition_table (struct block *block, block_sector_t sector,
                            e->size, *part_nr);
         }
     }
-
-  free (pt);
 }
 
 /* We have found a primary or logical partition of the given TYPE
@@ -317,8 +364,31 @@ partition_write (void *p_, block_sector_t sector, const void *buffer)
   block_write (p->block, p->start + sector, buffer);
 }
 
+/* Reads CNT sectors starting at SECTOR from partition P into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
+static void
+partition_read_multiple (void *p_, block_sector_t sector, size_t cnt,
+                         void *buffer)
+{
+  struct partition *p = p_;
+  block_read_multiple (p->block, p->start + sector, cnt, buffer);
+}
+
+/* Flushes the write cache of the device that holds partition
+   P.  The device has one cache for all of its partitions, so this
+   also covers writes to P's siblings. */
+static void
+partition_flush (void *p_)
+{
+  struct partition *p = p_;
+  block_flush (p->block);
+}
+
 static struct block_operations partition_operations =
   {
     partition_read,
-    partition_write
+    partition_write,
+    partition_read_multiple,
+    partition_flush
   };
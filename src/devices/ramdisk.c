@@ -0,0 +1,123 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A block device backed by kernel memory.
+
+   The disk's contents live in individually allocated pages from
+   the kernel pool, so a large RAM disk does not need a large
+   contiguous run of free pages.  Reads and writes are plain
+   memory copies, which makes the RAM disk useful for measuring
+   the file system's own overhead without the cost of emulated
+   PIO transfers, and as a fast scratch or swap area.
+
+   The contents do not survive a reboot. */
+
+/* Number of sectors stored in each page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A RAM disk. */
+struct ramdisk
+  {
+    uint8_t **pages;            /* Backing pages. */
+    size_t page_cnt;            /* Number of backing pages. */
+    struct lock lock;           /* Serializes accesses. */
+  };
+
+static struct block_operations ramdisk_operations;
+
+/* Creates a RAM disk SIZE_KB kilobytes in size, rounded up to a
+   whole number of pages, and registers it with the block layer
+   as "ram0".  It may then be given a role with -filesys=ram0,
+   -scratch=ram0, or -swap=ram0.  Panics if memory runs out. */
+void
+ramdisk_init (size_t size_kb)
+{
+  struct ramdisk *rd;
+  size_t i;
+
+  if (size_kb == 0)
+    return;
+
+  rd = malloc (sizeof *rd);
+  if (rd == NULL)
+    PANIC ("Failed to allocate memory for RAM disk descriptor");
+  rd->page_cnt = DIV_ROUND_UP (size_kb * 1024, PGSIZE);
+  rd->pages = malloc (rd->page_cnt * sizeof *rd->pages);
+  if (rd->pages == NULL)
+    PANIC ("Failed to allocate memory for RAM disk page table");
+  for (i = 0; i < rd->page_cnt; i++)
+    {
+      rd->pages[i] = palloc_get_page (PAL_ZERO);
+      if (rd->pages[i] == NULL)
+        PANIC ("ram0: out of memory after %zu of %zu pages",
+               i, rd->page_cnt);
+    }
+  lock_init_named (&rd->lock, "ramdisk");
+
+  block_register ("ram0", BLOCK_RAW, "RAM disk",
+                  rd->page_cnt * SECTORS_PER_PAGE, &ramdisk_operations, rd);
+}
+
+/* Returns the address of SECTOR within RAM disk RD. */
+static uint8_t *
+sector_addr (struct ramdisk *rd, block_sector_t sector)
+{
+  ASSERT (sector / SECTORS_PER_PAGE < rd->page_cnt);
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads sector SECTOR from RAM disk RD into BUFFER, which must
+   have room for BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_read (void *rd_, block_sector_t sector, void *buffer)
+{
+  struct ramdisk *rd = rd_;
+  lock_acquire (&rd->lock);
+  memcpy (buffer, sector_addr (rd, sector), BLOCK_SECTOR_SIZE);
+  lock_release (&rd->lock);
+}
+
+/* Writes sector SECTOR to RAM disk RD from BUFFER, which must
+   contain BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_write (void *rd_, block_sector_t sector, const void *buffer)
+{
+  struct ramdisk *rd = rd_;
+  lock_acquire (&rd->lock);
+  memcpy (sector_addr (rd, sector), buffer, BLOCK_SECTOR_SIZE);
+  lock_release (&rd->lock);
+}
+
+/* Reads CNT sectors starting at SECTOR from RAM disk RD into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
+static void
+ramdisk_read_multiple (void *rd_, block_sector_t sector, size_t cnt,
+                       void *buffer)
+{
+  struct ramdisk *rd = rd_;
+  uint8_t *p = buffer;
+  size_t i;
+
+  lock_acquire (&rd->lock);
+  for (i = 0; i < cnt; i++)
+    memcpy (p + i * BLOCK_SECTOR_SIZE, sector_addr (rd, sector + i),
+            BLOCK_SECTOR_SIZE);
+  lock_release (&rd->lock);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_read_multiple,
+    NULL                        /* Writes are complete on return. */
+  };
@@ -5,6 +5,9 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/lockstat.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -121,6 +124,12 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  lockstat_print ();
+  if (malloc_track_enabled)
+    {
+      palloc_print_stats ();
+      malloc_print_stats ();
+    }
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -1,12 +1,14 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
   
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -20,11 +22,48 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Threads blocked in timer_sleep(), in order of increasing
+   wakeup_tick, so that the timer interrupt only has to look at
+   the front of the list.  Accessed only with interrupts off. */
+static struct list sleep_list;
+
+/* PIT cycles in one timer tick. */
+#define PIT_CYCLES_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Most ticks that one 16-bit PIT count can cover. */
+#define TICKLESS_MAX_TICKS (65535 / PIT_CYCLES_PER_TICK)
+
+/* -tickless: Stop the periodic timer while the CPU is idle? */
+bool timer_tickless;
+
+/* While the CPU idles with the periodic timer stopped, the number
+   of ticks that the pending one-shot count ends on, counting the
+   tick that its interrupt delivers; otherwise 0. */
+static int64_t tickless_ticks;
+
+/* PIT cycles in the pending one-shot count. */
+static uint16_t tickless_cycles;
+
+/* Time stamp counter (TSC) frequency, in Hz, and the TSC value
+   at the moment the OS booted.  Measured by timer_calibrate();
+   tsc_hz is 0 until then. */
+static uint64_t tsc_hz;
+static uint64_t tsc_boot;
+
+/* Number of timer ticks to measure the TSC over.  Each end of the
+   interval is a tick boundary, so the error is bounded by the
+   latency of the timer interrupt, not by the tick length. */
+#define TSC_CALIBRATE_TICKS 5
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
+static bool wakes_earlier (const struct list_elem *,
+                           const struct list_elem *, void *aux);
+static void tickless_skip (int64_t);
+static void tsc_calibrate (void);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -35,6 +74,7 @@ static void real_time_delay (int64_t num, int32_t denom);
 void
 timer_init (void) 
 {
+  list_init (&sleep_list);
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -64,6 +104,60 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  tsc_calibrate ();
+}
+
+/* Returns the current value of the CPU's time stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Measures the TSC frequency against the PIT, and works out the
+   TSC value at boot from the number of ticks so far. */
+static void
+tsc_calibrate (void)
+{
+  int64_t start;
+  uint64_t t0, t1;
+
+  /* Wait for a timer tick. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+
+  start = ticks;
+  t0 = rdtsc ();
+  while (ticks < start + TSC_CALIBRATE_TICKS)
+    barrier ();
+  t1 = rdtsc ();
+
+  tsc_hz = (t1 - t0) * TIMER_FREQ / TSC_CALIBRATE_TICKS;
+  tsc_boot = t0 - start * (tsc_hz / TIMER_FREQ);
+}
+
+/* Returns the number of nanoseconds since the OS booted.  Uses
+   the TSC, so the resolution is a few nanoseconds once
+   timer_calibrate() has run; before that it falls back to timer
+   tick resolution.  Assumes a constant-rate TSC, as virtual
+   machines and modern CPUs provide. */
+int64_t
+timer_ns (void)
+{
+  uint64_t cycles;
+
+  if (tsc_hz == 0)
+    return timer_ticks () * (1000 * 1000 * 1000 / TIMER_FREQ);
+
+  /* Split into whole seconds and a remainder, so that no
+     intermediate product overflows 64 bits. */
+  cycles = rdtsc () - tsc_boot;
+  return (cycles / tsc_hz * 1000000000
+          + cycles % tsc_hz * 1000000000 / tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -85,15 +179,37 @@ timer_elapsed (int64_t then)
 }
 
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.
+
+   The thread blocks on sleep_list until the timer interrupt
+   wakes it, so a sleeping thread costs nothing per tick and does
+   not count toward the MLFQS ready-thread load. */
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  old_level = intr_disable ();
+  cur->wakeup_tick = timer_ticks () + ticks;
+  list_insert_ordered (&sleep_list, &cur->elem, wakes_earlier, NULL);
+  thread_block ();
+  intr_set_level (old_level);
+}
+
+/* Returns true if the thread owning sleep_list element A wakes
+   up before the one owning B.  Threads that wake on the same
+   tick stay in the order they went to sleep. */
+static bool
+wakes_earlier (const struct list_elem *a, const struct list_elem *b,
+               void *aux UNUSED)
+{
+  return (list_entry (a, struct thread, elem)->wakeup_tick
+          < list_entry (b, struct thread, elem)->wakeup_tick);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -165,13 +281,123 @@ timer_print_stats (void)
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  If tickless idle is enabled and nothing needs
+   the timer for at least two ticks, replaces the periodic timer
+   by a single interrupt at the next deadline: the earliest
+   timer_sleep() wakeup or delayed work item, the next MLFQS
+   once-a-second update, or as far as one PIT count reaches,
+   whichever comes first.  The one-shot count ends exactly on a
+   tick boundary, so the tick phase is kept. */
+void
+timer_idle_enter (void)
+{
+  int64_t n = TICKLESS_MAX_TICKS;
+  uint16_t left;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || tickless_ticks != 0)
+    return;
+  if (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick - ticks < n)
+        n = t->wakeup_tick - ticks;
+    }
+  if (workqueue_next_due () - ticks < n)
+    n = workqueue_next_due () - ticks;
+  if (thread_mlfqs && TIMER_FREQ - ticks % TIMER_FREQ < n)
+    n = TIMER_FREQ - ticks % TIMER_FREQ;
+  if (n < 2)
+    return;
+
+  /* Finish the current tick, then run N - 1 more. */
+  left = pit_read_count (0);
+  if (left == 0 || left > PIT_CYCLES_PER_TICK)
+    left = PIT_CYCLES_PER_TICK;
+  tickless_cycles = left + (n - 1) * PIT_CYCLES_PER_TICK;
+  tickless_ticks = n;
+  pit_configure_oneshot (0, tickless_cycles);
+}
+
+/* Called by the scheduler, with interrupts off, when it switches
+   away from the idle thread.  If the periodic timer is stopped,
+   accounts for the whole ticks that have passed and shortens the
+   one-shot count so that it ends at the next tick boundary.  The
+   timer interrupt there restarts the periodic timer. */
+void
+timer_idle_exit (void)
+{
+  int elapsed, whole;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (tickless_ticks <= 1)
+    return;
+  elapsed = tickless_cycles - pit_read_count (0);
+  if (pit_output_high (0) || elapsed < 0 || elapsed >= tickless_cycles)
+    {
+      /* The count already ended and its interrupt is pending. */
+      tickless_skip (tickless_ticks - 1);
+      tickless_ticks = 1;
+      return;
+    }
+
+  whole = elapsed / PIT_CYCLES_PER_TICK;
+  if (whole > tickless_ticks - 1)
+    whole = tickless_ticks - 1;
+  tickless_skip (whole);
+  tickless_ticks = 1;
+  tickless_cycles = PIT_CYCLES_PER_TICK - elapsed % PIT_CYCLES_PER_TICK;
+  pit_configure_oneshot (0, tickless_cycles);
+}
+
+/* Advances the tick count by N ticks that passed while the CPU
+   was idle with the periodic timer stopped. */
+static void
+tickless_skip (int64_t n)
+{
+  ticks += n;
+  thread_idle_ticks (n);
+}
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
+  bool woke = false;
+
+  /* The one-shot count of a tickless idle period ended.  Credit
+     the idle ticks it covered and go back to periodic ticks. */
+  if (tickless_ticks != 0)
+    {
+      tickless_skip (tickless_ticks - 1);
+      tickless_ticks = 0;
+      pit_configure_channel (0, 2, TIMER_FREQ);
+    }
+
   ticks++;
+  while (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick > ticks)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+      woke = true;
+    }
+  if (workqueue_timer (ticks))
+    woke = true;
   thread_tick ();
+
+  /* A thread that just woke up may outrank the one we
+     interrupted. */
+  if (woke)
+    checkCurrentThreadPriority ();
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
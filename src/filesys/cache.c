@@ -1,5 +1,7 @@
 #include "filesys/cache.h"
+#include "filesys/checksum.h"
 #include "filesys/filesys.h"
+#include "threads/slab.h"
 
 
 struct buffer_cache *buffer_cache_list[64];
@@ -7,11 +9,15 @@ int buffer_cache_num;
 int old_one;
 bool check_init;
 
+/* Cache of struct buffer_cache. */
+static struct slab_cache buffer_cache_cache;
+
 void buffer_cache_init(){
   check_init = false;
   
   int i;
-  lock_init(&buffer_cache_lock);
+  lock_init_named(&buffer_cache_lock, "buffer_cache");
+  slab_cache_init(&buffer_cache_cache, "buffer_cache", sizeof(struct buffer_cache), NULL);
   for (i=0; i<64; i++){
     buffer_cache_list[i] = NULL;
   }
@@ -27,7 +33,7 @@ struct buffer_cache *create_buffer_cache (block_sector_t sector_id, void* data){
 
 
   struct buffer_cache *bce = NULL; 
-  bce = (struct buffer_cache *)malloc(sizeof(struct buffer_cache));
+  bce = slab_alloc(&buffer_cache_cache);
   if(!bce){
     return bce;
   }
@@ -47,11 +53,11 @@ void push_buffer_cache_to_list (struct buffer_cache *cache){
   // lock_acquire(&buffer_cache_lock);
   if(buffer_cache_num >= 64){
     if(buffer_cache_list[old_one]->is_dirty){
-      block_write (fs_device, buffer_cache_list[old_one]->sector_id, buffer_cache_list[old_one]->cache);
+      checksum_write (buffer_cache_list[old_one]->sector_id, buffer_cache_list[old_one]->cache);
       buffer_cache_list[old_one]->is_dirty = false;
     }
     free(buffer_cache_list[old_one]->cache);
-    free(buffer_cache_list[old_one]);
+    slab_free(&buffer_cache_cache, buffer_cache_list[old_one]);
     buffer_cache_list[old_one] = cache;
     old_one ++;
     if(old_one >= 64){
@@ -60,7 +66,7 @@ void push_buffer_cache_to_list (struct buffer_cache *cache){
   }else{
     if(!check_init){
       free(cache->cache);
-      free(cache);
+      slab_free(&buffer_cache_cache, cache);
       // lock_release(&buffer_cache_lock);
       return;
     }
@@ -77,11 +83,11 @@ void clear_buffer_cache_list(){
   for(i=0; i<64; i++){
     if(buffer_cache_list[i] != NULL){
       if(buffer_cache_list[i]->is_dirty){
-        block_write (fs_device, buffer_cache_list[i]->sector_id, buffer_cache_list[i]->cache);
+        checksum_write (buffer_cache_list[i]->sector_id, buffer_cache_list[i]->cache);
         buffer_cache_list[i]->is_dirty = false;
       }
       free(buffer_cache_list[i]->cache);
-      free(buffer_cache_list[i]);
+      slab_free(&buffer_cache_cache, buffer_cache_list[i]);
       buffer_cache_list[i] = NULL;
     }
   }
@@ -130,7 +136,7 @@ void buffer_cache_read(block_sector_t sector_id, void *buffer){
     memcpy(buffer, bce->cache, BLOCK_SECTOR_SIZE);
   }
   else{
-    block_read (fs_device, sector_id, buffer);
+    checksum_read (sector_id, buffer);
     bce = create_buffer_cache(sector_id, buffer);
     push_buffer_cache_to_list(bce);
   }
@@ -138,6 +144,26 @@ void buffer_cache_read(block_sector_t sector_id, void *buffer){
   lock_release(&buffer_cache_lock);
 }
 
+/* Writes back every dirty cached sector in [START, START + CNT)
+   without evicting it.  The sectors are only guaranteed to have
+   reached the device, not stable storage; follow with
+   block_flush() for that. */
+void buffer_cache_flush_range (block_sector_t start, size_t cnt){
+  int i;
+
+  lock_acquire(&buffer_cache_lock);
+  for(i = 0; i < buffer_cache_num; i++){
+    struct buffer_cache *bce = buffer_cache_list[i];
+    if(bce == NULL || !bce->is_dirty)
+      continue;
+    if(bce->sector_id - start < cnt){
+      checksum_write (bce->sector_id, bce->cache);
+      bce->is_dirty = false;
+    }
+  }
+  lock_release(&buffer_cache_lock);
+}
+
 void buffer_cache_write(block_sector_t sector_id, void *buffer){
   lock_acquire(&buffer_cache_lock);
 
@@ -28,6 +28,7 @@ void delete_buffer_cache (struct buffer_cache *cache);
 struct buffer_cache *get_buffer_cache (block_sector_t sector_id);
 void buffer_cache_read(block_sector_t sector_id, void *buffer);
 void buffer_cache_write(block_sector_t sector_id, void *buffer);
+void buffer_cache_flush_range (block_sector_t start, size_t cnt);
 
 
 
@@ -0,0 +1,396 @@
+#include "filesys/checksum.h"
+#include <crc32c.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+/* Per-sector checksums for the file system device.
+
+   When enabled, we keep a CRC-32C of every sector as it was last
+   written to disk.  Sectors are verified against it when they
+   are read into the buffer cache, and low-priority scrub work
+   periodically rereads every allocated sector to catch
+   corruption in data that is not being used.
+
+   The checksums are stored in the checksum file, whose inode is
+   in CHECKSUM_SECTOR.  It holds a header followed by one 32-bit
+   checksum per sector of the device.  A checksum of 0 means "not
+   known yet"; a sector whose CRC really is 0 is recorded as 1,
+   which costs a negligible amount of detection strength.  The
+   checksum file's own data sectors are not checksummed, because
+   they are rewritten from the in-memory table directly.
+
+   The table on disk is only exact when it was written after
+   every sector write before it had reached stable storage, which
+   checksum_sync() arranges at fsync and checksum_close() at
+   shutdown.  The header's "clean" flag says whether that is so.
+   Before the first sector write after the table is written, the
+   flag is cleared on disk, so a crash, or a mount without
+   checksums, leaves it cleared.  A table found not clean at
+   mount is discarded and its checksums relearned as sectors are
+   read, rather than trusted and reported as mismatches. */
+
+/* Identifies the checksum file. */
+#define CHECKSUM_MAGIC 0x43534b43
+
+/* Number of sectors the scrubber checks per run of its work
+   item, and how long it waits between passes over the disk, in
+   ticks. */
+#define SCRUB_BATCH 8
+#define SCRUB_PASS_DELAY (30 * TIMER_FREQ)
+
+/* In-memory image of the checksum file. */
+struct checksum_table
+  {
+    unsigned magic;                     /* CHECKSUM_MAGIC. */
+    block_sector_t sector_cnt;          /* Number of sectors covered. */
+    unsigned clean;                     /* Matches the disk's contents? */
+    uint32_t sums[];                    /* One checksum per sector. */
+  };
+
+/* If true, keep a CRC-32C for every file system sector.
+   Controlled by kernel command-line option "-cksum". */
+bool checksum_enabled;
+
+static struct checksum_table *table;    /* Null if not in use. */
+static size_t table_size;               /* Bytes in the checksum file. */
+static block_sector_t table_start;      /* First sector of the file's data. */
+static block_sector_t table_end;        /* Sector just past its data. */
+static bool disk_clean;                 /* Clean flag as it is on disk. */
+
+/* Serializes disk transfers against updates of the table, so
+   that the scrubber never checks a sector while it is being
+   rewritten. */
+static struct lock checksum_lock;
+
+static struct work scrub_work;          /* Scrubs the next batch. */
+static bool scrub_running;              /* Cleared to stop the scrubber. */
+static block_sector_t scrub_sector;     /* Next sector to scrub. */
+static uint8_t *scrub_buffer;           /* One sector, for scrubbing. */
+
+/* Statistics. */
+static unsigned long long verify_cnt;   /* Sectors verified on read. */
+static unsigned long long scrub_cnt;    /* Sectors verified by scrubber. */
+static unsigned long long error_cnt;    /* Checksum mismatches. */
+
+static bool open_table (void);
+static void write_table (void);
+static void mark_stale (void);
+static void scrub (struct work *);
+
+/* Allocates the in-memory checksum table, if checksums are
+   enabled.  Call after free_map_init(). */
+void
+checksum_init (void)
+{
+  block_sector_t sector_cnt;
+
+  sector_cnt = block_size (fs_device);
+  table_size = sizeof *table + sector_cnt * sizeof *table->sums;
+  if (!checksum_enabled)
+    return;
+
+  /* Round up to whole sectors so that the table can be moved to
+     and from disk without a bounce buffer. */
+  table = calloc (1, ROUND_UP (table_size, BLOCK_SECTOR_SIZE));
+  if (table == NULL)
+    {
+      printf ("filesys: no memory for checksum table, checksums disabled\n");
+      checksum_enabled = false;
+      return;
+    }
+  table->magic = CHECKSUM_MAGIC;
+  table->sector_cnt = sector_cnt;
+  lock_init_named (&checksum_lock, "checksum");
+}
+
+/* Creates the checksum file while formatting the file system.
+   Must be called while the free map is open. */
+void
+checksum_create (void)
+{
+  if (table == NULL)
+    return;
+
+  if (!inode_create (CHECKSUM_SECTOR, table_size))
+    PANIC ("checksum file creation failed");
+  if (!open_table ())
+    PANIC ("can't open checksum file");
+  write_table ();
+}
+
+/* Loads the checksums from the checksum file and starts the
+   scrubber.  If the file system was formatted without
+   checksums, prints a message and carries on without them.  If
+   checksums are disabled, marks the checksum file, if any, as no
+   longer matching the disk. */
+void
+checksum_open (void)
+{
+  size_t i;
+
+  if (table == NULL)
+    {
+      mark_stale ();
+      return;
+    }
+
+  if (!open_table ())
+    {
+      printf ("filesys: no checksum file, checksums disabled\n");
+      free (table);
+      table = NULL;
+      checksum_enabled = false;
+      return;
+    }
+
+  for (i = 0; i < table_end - table_start; i++)
+    block_read (fs_device, table_start + i,
+                (uint8_t *) table + i * BLOCK_SECTOR_SIZE);
+  if (table->magic != CHECKSUM_MAGIC
+      || table->sector_cnt != block_size (fs_device))
+    PANIC ("checksum file is corrupt");
+  if (!table->clean)
+    {
+      printf ("filesys: checksum file not clean, relearning checksums\n");
+      memset (table->sums, 0, table->sector_cnt * sizeof *table->sums);
+    }
+  disk_clean = table->clean;
+
+  scrub_buffer = malloc (BLOCK_SECTOR_SIZE);
+  if (scrub_buffer != NULL)
+    {
+      scrub_running = true;
+      work_init (&scrub_work, scrub, PRI_MIN);
+      work_queue (&scrub_work);
+    }
+}
+
+/* Makes the checksum table on disk match every sector written so
+   far.  Call after the sectors to be made durable have been
+   written and the device's write cache flushed. */
+void
+checksum_sync (void)
+{
+  if (table == NULL)
+    return;
+
+  lock_acquire (&checksum_lock);
+  if (!disk_clean)
+    write_table ();
+  lock_release (&checksum_lock);
+}
+
+/* Stops the scrubber and writes the checksums to disk.
+   Call after the buffer cache has been flushed, so that the
+   table reflects everything on disk. */
+void
+checksum_close (void)
+{
+  if (table == NULL)
+    return;
+
+  lock_acquire (&checksum_lock);
+  scrub_running = false;
+  write_table ();
+  lock_release (&checksum_lock);
+  work_cancel (&scrub_work);
+  free (scrub_buffer);
+  scrub_buffer = NULL;
+
+  printf ("filesys: %llu sectors verified on read, %llu by scrub, "
+          "%llu checksum errors\n", verify_cnt, scrub_cnt, error_cnt);
+}
+
+/* Returns true if SECTOR has a checksum slot in the table. */
+static bool
+is_tracked (block_sector_t sector)
+{
+  return (table != NULL
+          && sector < table->sector_cnt
+          && (sector < table_start || sector >= table_end));
+}
+
+/* Returns the checksum to record for BUFFER, never 0. */
+static uint32_t
+compute_sum (const void *buffer)
+{
+  uint32_t sum = crc32c (0, buffer, BLOCK_SECTOR_SIZE);
+  return sum != 0 ? sum : 1;
+}
+
+/* Reports a checksum mismatch in SECTOR, found by WHO. */
+static void
+report_error (block_sector_t sector, const char *who)
+{
+  error_cnt++;
+  printf ("%s: checksum mismatch in sector %"PRDSNu" (found by %s)\n",
+          block_name (fs_device), sector, who);
+}
+
+/* Reads SECTOR of the file system device into BUFFER and
+   verifies it against its checksum, recording the checksum if
+   none is known yet. */
+void
+checksum_read (block_sector_t sector, void *buffer)
+{
+  uint32_t sum;
+
+  if (!is_tracked (sector))
+    {
+      block_read (fs_device, sector, buffer);
+      return;
+    }
+
+  lock_acquire (&checksum_lock);
+  block_read (fs_device, sector, buffer);
+  sum = compute_sum (buffer);
+  if (table->sums[sector] == 0)
+    table->sums[sector] = sum;
+  else if (table->sums[sector] != sum)
+    report_error (sector, "read");
+  verify_cnt++;
+  lock_release (&checksum_lock);
+}
+
+/* Writes BUFFER to SECTOR of the file system device and records
+   its checksum. */
+void
+checksum_write (block_sector_t sector, const void *buffer)
+{
+  if (!is_tracked (sector))
+    {
+      block_write (fs_device, sector, buffer);
+      return;
+    }
+
+  lock_acquire (&checksum_lock);
+  if (disk_clean)
+    {
+      /* The table on disk is about to go out of date.  Say so
+         before the data can reach the disk. */
+      table->clean = false;
+      block_write (fs_device, table_start, table);
+      block_flush (fs_device);
+      disk_clean = false;
+    }
+  block_write (fs_device, sector, buffer);
+  table->sums[sector] = compute_sum (buffer);
+  lock_release (&checksum_lock);
+}
+
+/* Opens the checksum file and finds where its data lives.
+   Returns false if CHECKSUM_SECTOR does not hold a checksum file
+   of the right size for this device. */
+static bool
+open_table (void)
+{
+  struct inode *inode = inode_open (CHECKSUM_SECTOR);
+  bool ok = false;
+
+  if (inode != NULL && inode_length (inode) == (off_t) table_size)
+    {
+      table_start = inode_byte_to_sector (inode, 0);
+      table_end = table_start + DIV_ROUND_UP (table_size, BLOCK_SECTOR_SIZE);
+      ok = table_end > table_start && table_end <= block_size (fs_device);
+    }
+  inode_close (inode);
+  if (!ok)
+    table_start = table_end = 0;
+  return ok;
+}
+
+/* Writes the in-memory table to the checksum file, marked clean.
+   The header sector, which holds the flag, is written only once
+   the rest is on stable storage, so that a crash partway through
+   leaves the table marked not clean. */
+static void
+write_table (void)
+{
+  size_t i;
+
+  for (i = 1; i < table_end - table_start; i++)
+    block_write (fs_device, table_start + i,
+                 (uint8_t *) table + i * BLOCK_SECTOR_SIZE);
+  block_flush (fs_device);
+  table->clean = true;
+  block_write (fs_device, table_start, table);
+  block_flush (fs_device);
+  disk_clean = true;
+}
+
+/* Clears the clean flag of the checksum file, if the file system
+   has one, because this mount writes sectors without updating
+   their checksums. */
+static void
+mark_stale (void)
+{
+  struct checksum_table *header;
+
+  if (!open_table ())
+    return;
+
+  header = malloc (BLOCK_SECTOR_SIZE);
+  if (header == NULL)
+    PANIC ("no memory to mark checksum file stale");
+  block_read (fs_device, table_start, header);
+  if (header->magic == CHECKSUM_MAGIC
+      && header->sector_cnt == block_size (fs_device)
+      && header->clean)
+    {
+      header->clean = false;
+      block_write (fs_device, table_start, header);
+      block_flush (fs_device);
+    }
+  free (header);
+  table_start = table_end = 0;
+}
+
+/* Scrub work.  Walks the next SCRUB_BATCH sectors of the file
+   system device, rereading each one that is allocated and has a
+   known checksum and checking it, then queues itself again to go
+   on a tick later, or after SCRUB_PASS_DELAY at the end of a pass.
+   Runs at the lowest priority, so it only uses the disk when
+   nobody else needs it. */
+static void
+scrub (struct work *w)
+{
+  int i;
+
+  for (i = 0; i < SCRUB_BATCH; i++)
+    {
+      lock_acquire (&checksum_lock);
+      if (!scrub_running)
+        {
+          lock_release (&checksum_lock);
+          return;
+        }
+      if (is_tracked (scrub_sector) && table->sums[scrub_sector] != 0
+          && free_map_in_use (scrub_sector))
+        {
+          block_read (fs_device, scrub_sector, scrub_buffer);
+          if (compute_sum (scrub_buffer) != table->sums[scrub_sector])
+            report_error (scrub_sector, "scrub");
+          scrub_cnt++;
+        }
+      lock_release (&checksum_lock);
+
+      if (++scrub_sector >= block_size (fs_device))
+        {
+          scrub_sector = 0;
+          work_queue_delayed (w, SCRUB_PASS_DELAY);
+          return;
+        }
+    }
+  work_queue_delayed (w, 1);
+}
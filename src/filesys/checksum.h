@@ -0,0 +1,20 @@
+#ifndef FILESYS_CHECKSUM_H
+#define FILESYS_CHECKSUM_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* If true, keep a CRC-32C for every file system sector.
+   Controlled by kernel command-line option "-cksum". */
+extern bool checksum_enabled;
+
+void checksum_init (void);
+void checksum_create (void);
+void checksum_open (void);
+void checksum_sync (void);
+void checksum_close (void);
+
+void checksum_read (block_sector_t, void *);
+void checksum_write (block_sector_t, const void *);
+
+#endif /* filesys/checksum.h */
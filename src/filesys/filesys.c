@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/checksum.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
@@ -23,7 +24,10 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  file_init ();
+  dir_init ();
   free_map_init ();
+  checksum_init ();
 
   buffer_cache_init();
 
@@ -32,6 +36,7 @@ filesys_init (bool format)
     do_format ();
 
   free_map_open ();
+  checksum_open ();
 }
 
 /* Shuts down the file system module, writing any unwritten data
@@ -43,6 +48,8 @@ filesys_done (void)
   
   free_map_close ();
   clear_buffer_cache_list();
+  checksum_close ();
+  block_flush (fs_device);
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -105,6 +112,7 @@ do_format (void)
   free_map_create ();
   if (!dir_create (ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
+  checksum_create ();
   free_map_close ();
   printf ("done.\n");
 }
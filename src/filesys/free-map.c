@@ -1,6 +1,7 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include "filesys/checksum.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
@@ -17,6 +18,15 @@ free_map_init (void)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  if (checksum_enabled)
+    bitmap_mark (free_map, CHECKSUM_SECTOR);
+}
+
+/* Returns true if SECTOR is currently allocated. */
+bool
+free_map_in_use (block_sector_t sector)
+{
+  return bitmap_test (free_map, sector);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -3,9 +3,11 @@
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/checksum.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "filesys/cache.h"
 
 /* Identifies an inode. */
@@ -58,11 +60,15 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache of struct inode. */
+static struct slab_cache inode_cache;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  slab_cache_init (&inode_cache, "inode", sizeof (struct inode), NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -90,7 +96,7 @@ inode_create (block_sector_t sector, off_t length)
       disk_inode->magic = INODE_MAGIC;
       if (free_map_allocate (sectors, &disk_inode->start)) 
         {
-          block_write (fs_device, sector, disk_inode);
+          checksum_write (sector, disk_inode);
           // buffer_cache_write (sector, disk_inode);
           if (sectors > 0) 
             {
@@ -98,7 +104,7 @@ inode_create (block_sector_t sector, off_t length)
               size_t i;
               
               for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
+                checksum_write (disk_inode->start + i, zeros);
                 // buffer_cache_write (disk_inode->start + i, zeros);
 
             }
@@ -131,7 +137,7 @@ inode_open (block_sector_t sector)
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = slab_alloc (&inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -141,7 +147,7 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  checksum_read (inode->sector, &inode->data);
   return inode;
 }
 
@@ -186,7 +192,7 @@ inode_close (struct inode *inode)
                             bytes_to_sectors (inode->data.length)); 
         }
 
-      free (inode); 
+      slab_free (&inode_cache, inode);
     }
 }
 
@@ -352,3 +358,26 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Makes INODE's data durable: writes its dirty sectors out of
+   the buffer cache, flushes the device's write cache, and then
+   brings the checksum table on disk up to date with them.  The
+   on-disk inode itself is only written at creation, so it needs
+   no write-back here. */
+void
+inode_sync (struct inode *inode)
+{
+  ASSERT (inode != NULL);
+  buffer_cache_flush_range (inode->data.start,
+                            bytes_to_sectors (inode->data.length));
+  block_flush (fs_device);
+  checksum_sync ();
+}
+
+/* Returns the block device sector that contains byte offset POS
+   within INODE, or -1 if INODE has no data at POS. */
+block_sector_t
+inode_byte_to_sector (const struct inode *inode, off_t pos)
+{
+  return byte_to_sector (inode, pos);
+}
@@ -0,0 +1,78 @@
+#include "crc32c.h"
+#include <stdbool.h>
+
+/* CRC-32C using the "slicing-by-8" technique.
+
+   The classic table-driven CRC consumes one byte per table
+   lookup, so each step depends on the result of the previous
+   one.  Slicing-by-8 keeps eight tables, where table K gives the
+   CRC contribution of a byte followed by K zero bytes.  That
+   lets us fold in eight bytes per iteration with eight
+   independent lookups, which is several times faster on the
+   512-byte blocks we checksum.
+
+   The tables occupy 8 kB and are computed on first use. */
+
+/* Reflected CRC-32C polynomial. */
+#define CRC32C_POLY 0x82f63b78
+
+static uint32_t tables[8][256];
+static bool tables_ready;
+
+/* Fills in the lookup tables. */
+static void
+init_tables (void)
+{
+  unsigned i, k;
+
+  for (i = 0; i < 256; i++)
+    {
+      uint32_t crc = i;
+      for (k = 0; k < 8; k++)
+        crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+      tables[0][i] = crc;
+    }
+  for (i = 0; i < 256; i++)
+    for (k = 1; k < 8; k++)
+      tables[k][i] = ((tables[k - 1][i] >> 8)
+                      ^ tables[0][tables[k - 1][i] & 0xff]);
+  tables_ready = true;
+}
+
+/* Returns the CRC-32C of the SIZE bytes in BUF, continuing from
+   CRC, which should be 0 for the first block of a message. */
+uint32_t
+crc32c (uint32_t crc, const void *buf_, size_t size)
+{
+  const uint8_t *buf = buf_;
+
+  if (!tables_ready)
+    init_tables ();
+
+  crc = ~crc;
+
+  /* Process bytes one at a time until BUF is aligned. */
+  for (; size > 0 && (uintptr_t) buf % 4 != 0; size--)
+    crc = (crc >> 8) ^ tables[0][(crc ^ *buf++) & 0xff];
+
+  /* Process eight bytes at a time. */
+  for (; size >= 8; size -= 8, buf += 8)
+    {
+      uint32_t lo = *(const uint32_t *) buf ^ crc;
+      uint32_t hi = *(const uint32_t *) (buf + 4);
+      crc = (tables[7][lo & 0xff]
+             ^ tables[6][(lo >> 8) & 0xff]
+             ^ tables[5][(lo >> 16) & 0xff]
+             ^ tables[4][lo >> 24]
+             ^ tables[3][hi & 0xff]
+             ^ tables[2][(hi >> 8) & 0xff]
+             ^ tables[1][(hi >> 16) & 0xff]
+             ^ tables[0][hi >> 24]);
+    }
+
+  /* Process any remaining bytes. */
+  for (; size > 0; size--)
+    crc = (crc >> 8) ^ tables[0][(crc ^ *buf++) & 0xff];
+
+  return ~crc;
+}
@@ -0,0 +1,11 @@
+#ifndef __LIB_KERNEL_CRC32C_H
+#define __LIB_KERNEL_CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* CRC-32C (Castagnoli), as used by iSCSI, ext4, and btrfs. */
+
+uint32_t crc32c (uint32_t crc, const void *, size_t size);
+
+#endif /* lib/kernel/crc32c.h */
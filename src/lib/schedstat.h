@@ -0,0 +1,30 @@
+#ifndef __LIB_SCHEDSTAT_H
+#define __LIB_SCHEDSTAT_H
+
+#include <stdint.h>
+
+/* Scheduler statistics for one thread, as reported by the
+   schedstat() system call.  Times are in nanoseconds. */
+struct schedstat
+  {
+    int64_t run_ns;             /* Time spent running. */
+    int64_t ready_ns;           /* Time spent ready but not running. */
+    int64_t lock_ns;            /* Time spent blocked in lock_acquire(). */
+    uint32_t voluntary;         /* Switches away because it blocked. */
+    uint32_t involuntary;       /* Switches away while still runnable. */
+  };
+
+/* Number of buckets in the scheduling latency histogram. */
+#define SCHEDLAT_CNT 24
+
+/* Histogram of scheduling latency, the time from a thread being
+   woken by thread_unblock() until it runs, as reported by the
+   schedlat() system call.  Bucket 0 counts latencies under 1 us,
+   bucket I > 0 counts latencies in [2**(I-1), 2**I) us, and the
+   last bucket also absorbs anything longer. */
+struct schedlat
+  {
+    uint64_t buckets[SCHEDLAT_CNT];
+  };
+
+#endif /* lib/schedstat.h */
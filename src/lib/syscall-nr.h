@@ -28,7 +28,13 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_FSYNC,                  /* Makes a file's data durable. */
+    SYS_CLOCK,                  /* Reads the monotonic clock. */
+    SYS_SCHEDSTAT,              /* Reads a thread's scheduler statistics. */
+    SYS_SCHEDLAT                /* Reads the scheduling latency histogram. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -182,3 +182,30 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+fsync (int fd)
+{
+  return syscall1 (SYS_FSYNC, fd);
+}
+
+/* Returns nanoseconds since the OS booted. */
+int64_t
+clock_ns (void)
+{
+  int64_t ns;
+  syscall1 (SYS_CLOCK, &ns);
+  return ns;
+}
+
+bool
+schedstat (pid_t pid, struct schedstat *stats)
+{
+  return syscall2 (SYS_SCHEDSTAT, pid, stats);
+}
+
+void
+schedlat (struct schedlat *lat)
+{
+  syscall1 (SYS_SCHEDLAT, lat);
+}
@@ -2,7 +2,9 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
+#include <schedstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +47,10 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+bool fsync (int fd);
+int64_t clock_ns (void);
+bool schedstat (pid_t, struct schedstat *);
+void schedlat (struct schedlat *);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,44 @@
+/* Checks that a thread created between the once-a-second
+   updates gets its priority from nice and recent_cpu, not from
+   the priority passed to thread_create().
+
+   The main thread sets its nice value to 20, which lowers its
+   priority well below PRI_MAX, then waits until halfway between
+   two once-a-second updates and creates a thread, asking for
+   PRI_MAX.  The new thread inherits the main thread's nice and
+   recent_cpu, so its priority can be no higher than the main
+   thread's, and it must not preempt the main thread. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static void child_thread (void *);
+
+void
+test_mlfqs_create (void) 
+{
+  int64_t ofs;
+
+  ASSERT (thread_mlfqs);
+
+  thread_set_nice (20);
+
+  /* Wait until halfway between two once-a-second updates. */
+  ofs = timer_ticks () % TIMER_FREQ;
+  timer_sleep ((TIMER_FREQ / 2 - ofs + TIMER_FREQ) % TIMER_FREQ);
+
+  thread_create ("child", PRI_MAX, child_thread, NULL);
+  msg ("Main thread created child thread.");
+
+  timer_sleep (TIMER_FREQ);
+  msg ("Main thread finished.");
+}
+
+static void
+child_thread (void *aux UNUSED) 
+{
+  msg ("Child thread running.");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mlfqs-create) begin
+(mlfqs-create) Main thread created child thread.
+(mlfqs-create) Child thread running.
+(mlfqs-create) Main thread finished.
+(mlfqs-create) end
+EOF
+pass;
@@ -0,0 +1,26 @@
+/* Reads the monotonic clock many times and checks that it never
+   goes backward and that it advances. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int64_t first, prev, now;
+  int i;
+
+  first = prev = clock_ns ();
+  CHECK (first > 0, "clock_ns is positive");
+  for (i = 0; i < 10000; i++)
+    {
+      now = clock_ns ();
+      if (now < prev)
+        fail ("clock went backward by %lld ns after %d reads",
+              prev - now, i);
+      prev = now;
+    }
+  msg ("clock never went backward");
+  CHECK (prev > first, "clock advanced");
+}
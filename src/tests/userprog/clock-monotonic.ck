@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clock-monotonic) begin
+(clock-monotonic) clock_ns is positive
+(clock-monotonic) clock never went backward
+(clock-monotonic) clock advanced
+(clock-monotonic) end
+clock-monotonic: exit(0)
+EOF
+pass;
@@ -0,0 +1,17 @@
+/* Tries to fsync invalid fds and the console, which must either
+   fail silently or terminate the process with exit code -1. */
+
+#include <limits.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  CHECK (!fsync (0x20101234), "fsync bad fd");
+  CHECK (!fsync (0), "fsync stdin");
+  CHECK (!fsync (1), "fsync stdout");
+  CHECK (!fsync (-1), "fsync -1");
+  CHECK (!fsync (INT_MAX), "fsync INT_MAX");
+}
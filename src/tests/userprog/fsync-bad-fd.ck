@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(fsync-bad-fd) begin
+(fsync-bad-fd) fsync bad fd
+(fsync-bad-fd) fsync stdin
+(fsync-bad-fd) fsync stdout
+(fsync-bad-fd) fsync -1
+(fsync-bad-fd) fsync INT_MAX
+(fsync-bad-fd) end
+fsync-bad-fd: exit(0)
+EOF
+(fsync-bad-fd) begin
+fsync-bad-fd: exit(-1)
+EOF
+pass;
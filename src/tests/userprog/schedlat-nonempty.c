@@ -0,0 +1,21 @@
+/* Reads the scheduling latency histogram.  Loading this program
+   already woke threads, so the histogram must not be empty. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct schedlat lat;
+  uint64_t total = 0;
+  int i;
+
+  for (i = 0; i < SCHEDLAT_CNT; i++)
+    lat.buckets[i] = 0;
+  schedlat (&lat);
+  for (i = 0; i < SCHEDLAT_CNT; i++)
+    total += lat.buckets[i];
+  CHECK (total > 0, "histogram is not empty");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(schedlat-nonempty) begin
+(schedlat-nonempty) histogram is not empty
+(schedlat-nonempty) end
+schedlat-nonempty: exit(0)
+EOF
+pass;
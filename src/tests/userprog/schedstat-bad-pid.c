@@ -0,0 +1,17 @@
+/* Asks for the scheduler statistics of pids that do not exist,
+   which must fail, and of the caller, which must succeed. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct schedstat stats;
+
+  CHECK (schedstat (0, &stats), "schedstat self");
+  CHECK (stats.run_ns > 0, "self has run");
+  CHECK (!schedstat ((pid_t) 0x0c020301, &stats), "schedstat bad pid");
+  CHECK (!schedstat (-1, &stats), "schedstat -1");
+}
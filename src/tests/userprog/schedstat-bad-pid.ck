@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(schedstat-bad-pid) begin
+(schedstat-bad-pid) schedstat self
+(schedstat-bad-pid) self has run
+(schedstat-bad-pid) schedstat bad pid
+(schedstat-bad-pid) schedstat -1
+(schedstat-bad-pid) end
+schedstat-bad-pid: exit(0)
+EOF
+pass;
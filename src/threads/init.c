@@ -1,5 +1,6 @@
 #include "threads/init.h"
 #include <console.h>
+#include <ctype.h>
 #include <debug.h>
 #include <inttypes.h>
 #include <limits.h>
@@ -18,9 +19,13 @@
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
+#include "threads/lockstat.h"
+#include "threads/workqueue.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/rcu.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -34,6 +39,8 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/ramdisk.h"
+#include "filesys/checksum.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -49,6 +56,9 @@ static bool format_filesys;
    overriding the defaults. */
 static const char *filesys_bdev_name;
 static const char *scratch_bdev_name;
+
+/* -ramdisk: Size of the RAM disk in kB, 0 for none. */
+static size_t ramdisk_kb;
 #ifdef VM
 static const char *swap_bdev_name;
 #endif
@@ -64,10 +74,15 @@ static char **read_command_line (void);
 static char **parse_options (char **argv);
 static void run_actions (char **argv);
 static void usage (void);
+static void print_lockstat (char **argv);
+static void print_slabstats (char **argv);
+static void print_memstat (char **argv);
 
 #ifdef FILESYS
 static void locate_block_devices (void);
 static void locate_block_device (enum block_type, const char *name);
+static void print_block_stats (char **argv);
+static size_t parse_ramdisk_kb (const char *value);
 #endif
 
 int main (void) NO_RETURN;
@@ -113,16 +128,20 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  workqueue_init ();
+  rcu_init ();
   serial_init_queue ();
   timer_calibrate ();
 
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
+  ramdisk_init (ramdisk_kb);
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
@@ -243,10 +262,16 @@ parse_options (char **argv)
 #ifdef FILESYS
       else if (!strcmp (name, "-f"))
         format_filesys = true;
+      else if (!strcmp (name, "-cksum"))
+        checksum_enabled = true;
       else if (!strcmp (name, "-filesys"))
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-ramdisk"))
+        ramdisk_kb = parse_ramdisk_kb (value);
+      else if (!strcmp (name, "-bigdisk"))
+        ide_allow_big_disks = true;
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
@@ -256,6 +281,14 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-lockstat"))
+        lockstat_enabled = true;
+      else if (!strcmp (name, "-memtrack"))
+        malloc_track_enabled = true;
+      else if (!strcmp (name, "-wq"))
+        workqueue_threads = atoi (value);
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -309,12 +342,16 @@ run_actions (char **argv)
   static const struct action actions[] = 
     {
       {"run", 2, run_task},
+      {"lockstat", 1, print_lockstat},
+      {"slabstats", 1, print_slabstats},
+      {"memstat", 1, print_memstat},
 #ifdef FILESYS
       {"ls", 1, fsutil_ls},
       {"cat", 2, fsutil_cat},
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+      {"blockstats", 1, print_block_stats},
 #endif
       {NULL, 0, NULL},
     };
@@ -343,6 +380,29 @@ run_actions (char **argv)
   
 }
 
+/* Prints lock contention statistics. */
+static void
+print_lockstat (char **argv UNUSED)
+{
+  lockstat_print ();
+}
+
+/* Prints slab cache statistics. */
+static void
+print_slabstats (char **argv UNUSED)
+{
+  slab_print_stats ();
+}
+
+/* Prints page, malloc() and slab allocator statistics. */
+static void
+print_memstat (char **argv UNUSED)
+{
+  palloc_print_stats ();
+  malloc_print_stats ();
+  slab_print_stats ();
+}
+
 /* Prints a kernel command line help message and powers off the
    machine. */
 static void
@@ -357,10 +417,14 @@ usage (void)
 #else
           "  run TEST           Run TEST.\n"
 #endif
+          "  lockstat           Print lock contention statistics.\n"
+          "  slabstats          Print slab cache statistics.\n"
+          "  memstat            Print memory allocator statistics.\n"
 #ifdef FILESYS
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
           "  rm FILE            Delete FILE.\n"
+          "  blockstats         Print block device request statistics.\n"
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  extract            Untar from scratch device into file system.\n"
           "  append FILE        Append FILE to tar file on scratch device.\n"
@@ -371,14 +435,21 @@ usage (void)
           "  -r                 Reboot after actions.\n"
 #ifdef FILESYS
           "  -f                 Format file system device during startup.\n"
+          "  -cksum             Checksum file system sectors (set at format).\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -ramdisk=KB        Create a KB-kilobyte RAM disk named ram0.\n"
+          "  -bigdisk           Allow IDE disks of 1 GB or more.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -tickless          Stop the timer tick while the CPU is idle.\n"
+          "  -lockstat          Collect lock contention statistics.\n"
+          "  -memtrack          Tag malloc() blocks with their call sites.\n"
+          "  -wq=N              Run deferred work on N kernel threads.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -387,6 +458,31 @@ usage (void)
 }
 
 #ifdef FILESYS
+/* Returns the RAM disk size given as VALUE, the argument of
+   "-ramdisk=", in kB.  Panics unless VALUE is a positive decimal
+   number no larger than the machine's RAM. */
+static size_t
+parse_ramdisk_kb (const char *value)
+{
+  size_t ram_kb = (size_t) init_ram_pages * (PGSIZE / 1024);
+  size_t kb = 0;
+  const char *p;
+
+  if (value == NULL || *value == '\0')
+    PANIC ("-ramdisk requires a size in kB");
+  for (p = value; *p != '\0'; p++)
+    {
+      if (!isdigit ((unsigned char) *p))
+        PANIC ("-ramdisk=%s: size must be a number of kB", value);
+      kb = kb * 10 + (*p - '0');
+      if (kb > ram_kb)
+        PANIC ("-ramdisk=%s: larger than RAM (%zu kB)", value, ram_kb);
+    }
+  if (kb == 0)
+    PANIC ("-ramdisk=%s: size must be positive", value);
+  return kb;
+}
+
 /* Figure out what block devices to cast in the various Pintos roles. */
 static void
 locate_block_devices (void)
@@ -426,4 +522,11 @@ locate_block_device (enum block_type role, const char *name)
       block_set_role (role, block);
     }
 }
+
+/* Prints request histograms for every block device. */
+static void
+print_block_stats (char **argv UNUSED)
+{
+  block_print_histograms ();
+}
 #endif
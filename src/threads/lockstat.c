@@ -0,0 +1,213 @@
+#include "threads/lockstat.h"
+#include <debug.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+
+/* Lock contention statistics.
+
+   Every lock initialized with the same name shares one lockstat,
+   so that, for example, the locks of all the malloc descriptors
+   are reported together.  For each name we count acquisitions
+   and contended acquisitions, total and longest time spent
+   waiting for and holding the lock, and the call sites that most
+   often had to wait.
+
+   Call sites are tracked with the "space saving" scheme: when
+   every slot is taken, a new site replaces the least contended
+   one and inherits its count, so a site that is truly hot always
+   stays in the table. */
+
+/* Number of distinct lock names tracked. */
+#define LOCKSTAT_CNT 32
+
+/* Call sites tracked per lock name, and how many are printed. */
+#define SITE_CNT 8
+#define SITE_PRINT_CNT 4
+
+/* A call site of lock_acquire() that had to wait. */
+struct lockstat_site
+  {
+    void *pc;                   /* Return address in the caller. */
+    uint64_t contended;         /* Contended acquisitions from here. */
+    int64_t wait_ns;            /* Time spent waiting from here. */
+  };
+
+/* Statistics shared by all locks of one name. */
+struct lockstat
+  {
+    const char *name;           /* Name given to lock_init_named(). */
+    uint64_t acquired;          /* Successful acquisitions. */
+    uint64_t contended;         /* Acquisitions that had to wait. */
+    int64_t wait_ns;            /* Total time spent waiting. */
+    int64_t wait_max_ns;        /* Longest single wait. */
+    int64_t hold_ns;            /* Total time held. */
+    int64_t hold_max_ns;        /* Longest single hold. */
+    struct lockstat_site sites[SITE_CNT]; /* Most contended callers. */
+  };
+
+bool lockstat_enabled;
+
+static struct lockstat lockstats[LOCKSTAT_CNT];
+static size_t lockstat_cnt;
+
+/* Returns the statistics for locks named NAME, creating them if
+   necessary.  Returns a null pointer if lockstat is disabled or
+   too many names are already in use. */
+struct lockstat *
+lockstat_lookup (const char *name)
+{
+  struct lockstat *s = NULL;
+  enum intr_level old_level;
+  size_t i;
+
+  if (!lockstat_enabled || name == NULL)
+    return NULL;
+
+  old_level = intr_disable ();
+  for (i = 0; i < lockstat_cnt; i++)
+    if (!strcmp (lockstats[i].name, name))
+      {
+        s = &lockstats[i];
+        break;
+      }
+  if (s == NULL && lockstat_cnt < LOCKSTAT_CNT)
+    {
+      s = &lockstats[lockstat_cnt++];
+      s->name = name;
+    }
+  intr_set_level (old_level);
+
+  return s;
+}
+
+/* Counts a contended acquisition of S from PC that waited
+   WAIT_NS.  Interrupts must be off. */
+static void
+record_site (struct lockstat *s, void *pc, int64_t wait_ns)
+{
+  struct lockstat_site *site = &s->sites[0];
+  size_t i;
+
+  for (i = 0; i < SITE_CNT; i++)
+    {
+      if (s->sites[i].pc == pc)
+        {
+          site = &s->sites[i];
+          break;
+        }
+      if (s->sites[i].contended < site->contended)
+        site = &s->sites[i];
+    }
+  if (site->pc != pc)
+    {
+      /* Replace the least contended site, or an unused one. */
+      site->pc = pc;
+      site->wait_ns = 0;
+    }
+  site->contended++;
+  site->wait_ns += wait_ns;
+}
+
+/* Records that the current thread has just acquired LOCK, which
+   must have statistics.  If it had to wait, SITE is the caller
+   of lock_acquire() and WAIT_NS the time spent waiting;
+   otherwise SITE is a null pointer. */
+void
+lockstat_acquired (struct lock *lock, void *site, int64_t wait_ns)
+{
+  struct lockstat *s = lock->stat;
+  enum intr_level old_level;
+
+  ASSERT (s != NULL);
+
+  old_level = intr_disable ();
+  s->acquired++;
+  if (site != NULL)
+    {
+      s->contended++;
+      s->wait_ns += wait_ns;
+      if (wait_ns > s->wait_max_ns)
+        s->wait_max_ns = wait_ns;
+      record_site (s, site, wait_ns);
+    }
+  lock->stat_since = timer_ns ();
+  intr_set_level (old_level);
+}
+
+/* Records that the current thread is releasing LOCK, which must
+   have statistics. */
+void
+lockstat_released (struct lock *lock)
+{
+  struct lockstat *s = lock->stat;
+  enum intr_level old_level;
+  int64_t hold_ns;
+
+  ASSERT (s != NULL);
+
+  old_level = intr_disable ();
+  hold_ns = timer_ns () - lock->stat_since;
+  s->hold_ns += hold_ns;
+  if (hold_ns > s->hold_max_ns)
+    s->hold_max_ns = hold_ns;
+  intr_set_level (old_level);
+}
+
+/* Orders lockstats by descending contended count, for qsort(). */
+static int
+compare_contended (const void *a_, const void *b_)
+{
+  const struct lockstat *a = *(const struct lockstat **) a_;
+  const struct lockstat *b = *(const struct lockstat **) b_;
+
+  return a->contended > b->contended ? -1 : a->contended < b->contended;
+}
+
+/* Orders call sites by descending contended count, for qsort(). */
+static int
+compare_sites (const void *a_, const void *b_)
+{
+  const struct lockstat_site *a = a_;
+  const struct lockstat_site *b = b_;
+
+  return a->contended > b->contended ? -1 : a->contended < b->contended;
+}
+
+/* Prints lock statistics, most contended locks first, if
+   lockstat is enabled.  Times are in microseconds. */
+void
+lockstat_print (void)
+{
+  struct lockstat *sorted[LOCKSTAT_CNT];
+  size_t i, j;
+
+  if (!lockstat_enabled)
+    return;
+
+  for (i = 0; i < lockstat_cnt; i++)
+    sorted[i] = &lockstats[i];
+  qsort (sorted, lockstat_cnt, sizeof *sorted, compare_contended);
+
+  printf ("Lockstat: %-14s %10s %10s %10s %8s %10s %8s\n",
+          "name", "acquired", "contended", "wait", "max", "hold", "max");
+  for (i = 0; i < lockstat_cnt; i++)
+    {
+      struct lockstat *s = sorted[i];
+      struct lockstat_site sites[SITE_CNT];
+
+      printf ("          %-14s %10llu %10llu %10lld %8lld %10lld %8lld\n",
+              s->name, s->acquired, s->contended,
+              s->wait_ns / 1000, s->wait_max_ns / 1000,
+              s->hold_ns / 1000, s->hold_max_ns / 1000);
+
+      memcpy (sites, s->sites, sizeof sites);
+      qsort (sites, SITE_CNT, sizeof *sites, compare_sites);
+      for (j = 0; j < SITE_PRINT_CNT && sites[j].contended > 0; j++)
+        printf ("            from %p: %llu contended, %lld waiting\n",
+                sites[j].pc, sites[j].contended, sites[j].wait_ns / 1000);
+    }
+}
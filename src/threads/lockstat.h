@@ -0,0 +1,18 @@
+#ifndef THREADS_LOCKSTAT_H
+#define THREADS_LOCKSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct lock;
+
+/* If true, named locks collect contention statistics.
+   Controlled by the kernel command-line option "-lockstat". */
+extern bool lockstat_enabled;
+
+struct lockstat *lockstat_lookup (const char *name);
+void lockstat_acquired (struct lock *, void *site, int64_t wait_ns);
+void lockstat_released (struct lock *);
+void lockstat_print (void);
+
+#endif /* threads/lockstat.h */
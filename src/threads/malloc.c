@@ -4,16 +4,22 @@
 #include <round.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
+   The size of each request, in bytes, is rounded up to the
+   nearest size class and assigned to the "descriptor" that
+   manages blocks of that size.  Size classes are spaced about
+   1.25x apart, and each is as big as it can be without fitting
+   fewer blocks into an arena, so that little of a page is left
+   over past the last block.  The descriptor keeps a list of free blocks.  If
    the free list is nonempty, one of its blocks is used to
    satisfy the request.
 
@@ -29,10 +35,39 @@
    and give the arena back to the page allocator.
 
    We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   because they're too big to fit two to a page with an arena
+   header.  We handle those by allocating contiguous pages with
+   the page allocator and returning the first page itself, with
+   no header, so that a request for a whole number of pages costs
+   exactly that many.  Small blocks never start on a page
+   boundary, which is how free() tells the two apart; the size of
+   each big block is recorded in a small hash table on the side.
+   The page allocator's bitmap coalesces the pages of freed big
+   blocks with their free neighbors.
+
+   In front of each descriptor's free list sits a small
+   "magazine" of free blocks, an array that malloc() pops from and
+   free() pushes to with interrupts briefly off and no lock.
+   Only when the magazine runs empty or full do we take the
+   descriptor's lock, to move MAG_BATCH blocks at a time between
+   it and the free list.  Blocks in a magazine count as in use as
+   far as their arenas are concerned, so an arena is not given
+   back while the magazine holds any of its blocks.
+
+   Each descriptor counts its live blocks, their peak, and its
+   allocations, as seen by malloc()'s callers.  With the
+   "-memtrack" option, malloc() also tags each block with its
+   caller's address in a table on the side, so that the blocks
+   still live at any point can be attributed to the code that
+   allocated them. */
+
+/* Number of free blocks a descriptor's magazine holds, and the
+   number moved between magazine and free list at a time. */
+#define MAG_SIZE 16
+#define MAG_BATCH (MAG_SIZE / 2)
+
+/* Alignment of small blocks' sizes. */
+#define BLOCK_ALIGN 8
 
 /* Descriptor. */
 struct desc
@@ -41,6 +76,13 @@ struct desc
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+    struct block *mag[MAG_SIZE]; /* Magazine of free blocks. */
+    size_t mag_cnt;             /* Number of blocks in MAG. */
+
+    /* Statistics, updated with interrupts off. */
+    size_t live;                /* Blocks in use by callers. */
+    size_t peak;                /* Most blocks ever in use at once. */
+    unsigned long long alloc_cnt; /* Blocks allocated, ever. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -50,8 +92,8 @@ struct desc
 struct arena 
   {
     unsigned magic;             /* Always set to ARENA_MAGIC. */
-    struct desc *desc;          /* Owning descriptor, null for big block. */
-    size_t free_cnt;            /* Free blocks; pages in big block. */
+    struct desc *desc;          /* Owning descriptor. */
+    size_t free_cnt;            /* Free blocks. */
   };
 
 /* Free block. */
@@ -60,66 +102,324 @@ struct block
     struct list_elem free_elem; /* Free list element. */
   };
 
+/* Usable bytes in an arena. */
+#define ARENA_BYTES (PGSIZE - sizeof (struct arena))
+
+/* Largest small block, which fits two to an arena. */
+#define MAX_BLOCK_SIZE ROUND_DOWN (ARENA_BYTES / 2, BLOCK_ALIGN)
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[32];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Index into descs[] of the descriptor for requests of up to
+   N * BLOCK_ALIGN bytes, for N <= MAX_BLOCK_SIZE / BLOCK_ALIGN. */
+static uint8_t desc_index[MAX_BLOCK_SIZE / BLOCK_ALIGN + 1];
+
+/* A big block: contiguous pages that hold a single allocation. */
+struct big_block
+  {
+    struct list_elem elem;      /* In big_blocks[]. */
+    void *pages;                /* First page. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+/* Big blocks, hashed by page number. */
+#define BIG_BUCKETS 32
+static struct list big_blocks[BIG_BUCKETS];
+static struct lock big_lock;    /* Protects big_blocks[], big_*. */
+static struct slab_cache big_block_cache;
+
+/* Big block statistics. */
+static size_t big_live_pages;   /* Pages in live big blocks. */
+static size_t big_peak_pages;   /* Most pages ever live at once. */
+static unsigned long long big_alloc_cnt; /* Big blocks allocated, ever. */
+
+/* If true, each block is tagged with its allocation site. */
+bool malloc_track_enabled;
+
+/* Allocation site tag of a live block. */
+struct tag
+  {
+    struct list_elem elem;      /* In tags[]. */
+    void *block;                /* Tagged block. */
+    void *site;                 /* Return address in the allocator. */
+    size_t size;                /* Bytes requested. */
+  };
+
+/* Tags, hashed by block address. */
+#define TAG_BUCKETS 64
+static struct list tags[TAG_BUCKETS];
+static struct lock tag_lock;    /* Protects tags[]. */
+static struct slab_cache tag_cache;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct block *refill_magazine (struct desc *);
+static void drain_magazine (struct desc *, struct block *);
+
+/* Returns the size of the blocks that fit CNT to an arena. */
+static size_t
+arena_block_size (size_t cnt)
+{
+  return ROUND_DOWN (ARENA_BYTES / cnt, BLOCK_ALIGN);
+}
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) 
 {
-  size_t block_size;
+  size_t block_size = 0;
+  size_t cnt, i, n;
 
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+  /* Walk down through the number of blocks per arena, making a
+     size class whenever skipping ahead to the next candidate
+     would put it more than 1.25x past the last class. */
+  for (cnt = ARENA_BYTES / 16; cnt >= 2; cnt--)
     {
-      struct desc *d = &descs[desc_cnt++];
+      size_t size = arena_block_size (cnt);
+      size_t next = cnt > 2 ? arena_block_size (cnt - 1) : SIZE_MAX;
+      struct desc *d;
+
+      if (size == block_size
+          || (block_size != 0 && next <= block_size + block_size / 4))
+        continue;
+
+      block_size = size;
+      d = &descs[desc_cnt++];
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
       d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+      d->blocks_per_arena = ARENA_BYTES / block_size;
       list_init (&d->free_list);
-      lock_init (&d->lock);
+      lock_init_named (&d->lock, "malloc");
+      d->mag_cnt = 0;
+      d->live = d->peak = 0;
+      d->alloc_cnt = 0;
     }
+  ASSERT (block_size == MAX_BLOCK_SIZE);
+
+  for (i = n = 0; n < sizeof desc_index; n++)
+    {
+      while (descs[i].block_size < n * BLOCK_ALIGN)
+        i++;
+      desc_index[n] = i;
+    }
+
+  for (i = 0; i < BIG_BUCKETS; i++)
+    list_init (&big_blocks[i]);
+  lock_init_named (&big_lock, "malloc_big");
+  slab_cache_init (&big_block_cache, "big_block", sizeof (struct big_block),
+                   NULL);
+
+  for (i = 0; i < TAG_BUCKETS; i++)
+    list_init (&tags[i]);
+  lock_init_named (&tag_lock, "malloc_tag");
+  slab_cache_init (&tag_cache, "malloc_tag", sizeof (struct tag), NULL);
 }
 
-/* Obtains and returns a new block of at least SIZE bytes.
-   Returns a null pointer if memory is not available. */
-void *
-malloc (size_t size) 
+/* Returns the bucket of big_blocks[] for a big block starting at
+   PAGES. */
+static struct list *
+big_bucket (const void *pages)
+{
+  return &big_blocks[pg_no (pages) % BIG_BUCKETS];
+}
+
+/* Returns the record of the big block starting at PAGES.
+   big_lock must be held. */
+static struct big_block *
+find_big_block (const void *pages)
+{
+  struct list *bucket = big_bucket (pages);
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&big_lock));
+
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e))
+    {
+      struct big_block *bb = list_entry (e, struct big_block, elem);
+      if (bb->pages == pages)
+        return bb;
+    }
+  PANIC ("free of unallocated block %p", pages);
+}
+
+/* Allocates a big block of at least SIZE bytes.  Returns a null
+   pointer if memory is not available. */
+static void *
+malloc_big (size_t size)
+{
+  size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+  struct big_block *bb;
+
+  bb = slab_alloc (&big_block_cache);
+  if (bb == NULL)
+    return NULL;
+  bb->pages = palloc_get_multiple (0, page_cnt);
+  if (bb->pages == NULL)
+    {
+      slab_free (&big_block_cache, bb);
+      return NULL;
+    }
+  bb->page_cnt = page_cnt;
+
+  lock_acquire (&big_lock);
+  list_push_front (big_bucket (bb->pages), &bb->elem);
+  big_alloc_cnt++;
+  big_live_pages += page_cnt;
+  if (big_live_pages > big_peak_pages)
+    big_peak_pages = big_live_pages;
+  lock_release (&big_lock);
+  return bb->pages;
+}
+
+/* Frees big block PAGES. */
+static void
+free_big (void *pages)
+{
+  struct big_block *bb;
+
+  lock_acquire (&big_lock);
+  bb = find_big_block (pages);
+  list_remove (&bb->elem);
+  big_live_pages -= bb->page_cnt;
+  lock_release (&big_lock);
+
+  palloc_free_multiple (bb->pages, bb->page_cnt);
+  slab_free (&big_block_cache, bb);
+}
+
+/* Returns the bucket of tags[] for BLOCK. */
+static struct list *
+tag_bucket (const void *block)
+{
+  return &tags[((uintptr_t) block / BLOCK_ALIGN) % TAG_BUCKETS];
+}
+
+/* Tags BLOCK, of SIZE bytes, as allocated from SITE.  If no
+   memory is available for the tag, BLOCK goes untracked. */
+static void
+tag_block (void *block, size_t size, void *site)
+{
+  struct tag *t = slab_alloc (&tag_cache);
+
+  if (t == NULL)
+    return;
+  t->block = block;
+  t->site = site;
+  t->size = size;
+
+  lock_acquire (&tag_lock);
+  list_push_front (tag_bucket (block), &t->elem);
+  lock_release (&tag_lock);
+}
+
+/* Removes BLOCK's tag, if it has one.  Blocks allocated before
+   tracking was enabled, or whose tag could not be allocated,
+   have none. */
+static void
+untag_block (void *block)
+{
+  struct list *bucket = tag_bucket (block);
+  struct tag *t = NULL;
+  struct list_elem *e;
+
+  lock_acquire (&tag_lock);
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e))
+    if (list_entry (e, struct tag, elem)->block == block)
+      {
+        t = list_entry (e, struct tag, elem);
+        list_remove (&t->elem);
+        break;
+      }
+  lock_release (&tag_lock);
+
+  slab_free (&tag_cache, t);
+}
+
+/* Counts a block allocated from D.  Interrupts must be off. */
+static void
+count_alloc (struct desc *d)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  d->alloc_cnt++;
+  if (++d->live > d->peak)
+    d->peak = d->live;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes on
+   behalf of the code at SITE.  Returns a null pointer if memory
+   is not available. */
+static void *
+malloc_at (size_t size, void *site)
 {
   struct desc *d;
   struct block *b;
-  struct arena *a;
+  enum intr_level old_level;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
     return NULL;
 
-  /* Find the smallest descriptor that satisfies a SIZE-byte
-     request. */
-  for (d = descs; d < descs + desc_cnt; d++)
-    if (d->block_size >= size)
-      break;
-  if (d == descs + desc_cnt) 
+  if (size > MAX_BLOCK_SIZE)
     {
-      /* SIZE is too big for any descriptor.
-         Allocate enough pages to hold SIZE plus an arena. */
-      size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
-      a = palloc_get_multiple (0, page_cnt);
-      if (a == NULL)
-        return NULL;
-
-      /* Initialize the arena to indicate a big block of PAGE_CNT
-         pages, and return it. */
-      a->magic = ARENA_MAGIC;
-      a->desc = NULL;
-      a->free_cnt = page_cnt;
-      return a + 1;
+      /* SIZE is too big for any descriptor.  Allocate whole
+         pages. */
+      b = malloc_big (size);
+    }
+  else
+    {
+      /* Find the smallest descriptor that satisfies a SIZE-byte
+         request. */
+      d = &descs[desc_index[DIV_ROUND_UP (size, BLOCK_ALIGN)]];
+      ASSERT (d->block_size >= size);
+
+      /* Take a block from the magazine if it has one, otherwise
+         from the free list. */
+      old_level = intr_disable ();
+      if (d->mag_cnt > 0)
+        {
+          b = d->mag[--d->mag_cnt];
+          count_alloc (d);
+          intr_set_level (old_level);
+        }
+      else
+        {
+          intr_set_level (old_level);
+          b = refill_magazine (d);
+          if (b != NULL)
+            {
+              old_level = intr_disable ();
+              count_alloc (d);
+              intr_set_level (old_level);
+            }
+        }
     }
 
-  lock_acquire (&d->lock);
+  if (b != NULL && malloc_track_enabled)
+    tag_block (b, size, site);
+  return b;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size) 
+{
+  return malloc_at (size, __builtin_return_address (0));
+}
+
+/* Removes a block from D's free list, creating a new arena if
+   the list is empty, and returns it.  Returns a null pointer if
+   memory is not available.  D's lock must be held. */
+static struct block *
+take_free_block (struct desc *d)
+{
+  struct block *b;
+  struct arena *a;
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
 
   /* If the free list is empty, create a new arena. */
   if (list_empty (&d->free_list))
@@ -129,10 +429,7 @@ malloc (size_t size)
       /* Allocate a page. */
       a = palloc_get_page (0);
       if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
+        return NULL; 
 
       /* Initialize arena and add its blocks to the free list. */
       a->magic = ARENA_MAGIC;
@@ -145,14 +442,87 @@ malloc (size_t size)
         }
     }
 
-  /* Get a block from free list and return it. */
+  /* Get a block from free list. */
   b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
   a = block_to_arena (b);
   a->free_cnt--;
+  return b;
+}
+
+/* Returns block B to D's free list, giving its arena back to the
+   page allocator if the arena is now entirely unused.  D's lock
+   must be held. */
+static void
+put_free_block (struct desc *d, struct block *b)
+{
+  struct arena *a = block_to_arena (b);
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* Add block to free list. */
+  list_push_front (&d->free_list, &b->free_elem);
+
+  /* If the arena is now entirely unused, free it. */
+  if (++a->free_cnt >= d->blocks_per_arena) 
+    {
+      size_t i;
+
+      ASSERT (a->free_cnt == d->blocks_per_arena);
+      for (i = 0; i < d->blocks_per_arena; i++) 
+        {
+          struct block *b = arena_to_block (a, i);
+          list_remove (&b->free_elem);
+        }
+      palloc_free_page (a);
+    }
+}
+
+/* Called when D's magazine is empty.  Returns a block from D's
+   free list and moves up to MAG_BATCH more into the magazine.
+   Returns a null pointer if memory is not available. */
+static struct block *
+refill_magazine (struct desc *d)
+{
+  struct block *b;
+
+  lock_acquire (&d->lock);
+  b = take_free_block (d);
+  if (b != NULL)
+    {
+      enum intr_level old_level = intr_disable ();
+      size_t i;
+
+      for (i = 0; i < MAG_BATCH && d->mag_cnt < MAG_SIZE
+             && !list_empty (&d->free_list); i++)
+        d->mag[d->mag_cnt++] = take_free_block (d);
+      intr_set_level (old_level);
+    }
   lock_release (&d->lock);
   return b;
 }
 
+/* Called when D's magazine is full.  Returns block B and
+   MAG_BATCH blocks from the magazine to D's free list. */
+static void
+drain_magazine (struct desc *d, struct block *b)
+{
+  struct block *batch[MAG_BATCH];
+  enum intr_level old_level;
+  size_t cnt = 0;
+
+  lock_acquire (&d->lock);
+
+  old_level = intr_disable ();
+  while (cnt < MAG_BATCH && d->mag_cnt > 0)
+    batch[cnt++] = d->mag[--d->mag_cnt];
+  intr_set_level (old_level);
+
+  put_free_block (d, b);
+  while (cnt > 0)
+    put_free_block (d, batch[--cnt]);
+  lock_release (&d->lock);
+}
+
 /* Allocates and return A times B bytes initialized to zeroes.
    Returns a null pointer if memory is not available. */
 void *
@@ -167,7 +537,7 @@ calloc (size_t a, size_t b)
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc (size);
+  p = malloc_at (size, __builtin_return_address (0));
   if (p != NULL)
     memset (p, 0, size);
 
@@ -178,11 +548,15 @@ calloc (size_t a, size_t b)
 static size_t
 block_size (void *block) 
 {
-  struct block *b = block;
-  struct arena *a = block_to_arena (b);
-  struct desc *d = a->desc;
+  size_t page_cnt;
+
+  if (pg_ofs (block) != 0)
+    return block_to_arena (block)->desc->block_size;
 
-  return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
+  lock_acquire (&big_lock);
+  page_cnt = find_big_block (block)->page_cnt;
+  lock_release (&big_lock);
+  return page_cnt * PGSIZE;
 }
 
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
@@ -201,7 +575,7 @@ realloc (void *old_block, size_t new_size)
     }
   else 
     {
-      void *new_block = malloc (new_size);
+      void *new_block = malloc_at (new_size, __builtin_return_address (0));
       if (old_block != NULL && new_block != NULL)
         {
           size_t old_size = block_size (old_block);
@@ -220,49 +594,151 @@ free (void *p)
 {
   if (p != NULL)
     {
-      struct block *b = p;
-      struct arena *a = block_to_arena (b);
-      struct desc *d = a->desc;
-      
-      if (d != NULL) 
+      if (malloc_track_enabled)
+        untag_block (p);
+
+      if (pg_ofs (p) != 0) 
         {
           /* It's a normal block.  We handle it here. */
+          struct block *b = p;
+          struct desc *d = block_to_arena (b)->desc;
+          enum intr_level old_level;
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
           memset (b, 0xcc, d->block_size);
 #endif
-  
-          lock_acquire (&d->lock);
 
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+          /* Put the block in the magazine if there is room. */
+          old_level = intr_disable ();
+          d->live--;
+          if (d->mag_cnt < MAG_SIZE)
             {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
+              d->mag[d->mag_cnt++] = b;
+              intr_set_level (old_level);
+              return;
             }
+          intr_set_level (old_level);
 
-          lock_release (&d->lock);
+          drain_magazine (d, b);
         }
       else
         {
           /* It's a big block.  Free its pages. */
-          palloc_free_multiple (a, a->free_cnt);
-          return;
+          free_big (p);
         }
     }
 }
 
+/* Live blocks from one allocation site, for malloc_print_stats(). */
+struct site_stat
+  {
+    void *site;                 /* Return address in the allocator. */
+    size_t cnt;                 /* Live blocks. */
+    size_t bytes;               /* Bytes requested by those blocks. */
+  };
+
+/* Allocation sites printed by malloc_print_stats(). */
+#define SITE_CNT 64
+#define SITE_PRINT_CNT 16
+
+/* Orders sites by descending live bytes, for qsort(). */
+static int
+compare_site_bytes (const void *a_, const void *b_)
+{
+  const struct site_stat *a = a_;
+  const struct site_stat *b = b_;
+
+  return a->bytes > b->bytes ? -1 : a->bytes < b->bytes;
+}
+
+/* Prints the live blocks grouped by allocation site, largest
+   first.  Sites past the first SITE_CNT found are lumped
+   together. */
+static void
+print_sites (void)
+{
+  static struct site_stat sites[SITE_CNT];
+  size_t site_cnt = 0;
+  size_t other_cnt = 0, other_bytes = 0;
+  size_t i, j;
+
+  lock_acquire (&tag_lock);
+  for (i = 0; i < TAG_BUCKETS; i++)
+    {
+      struct list_elem *e;
+
+      for (e = list_begin (&tags[i]); e != list_end (&tags[i]);
+           e = list_next (e))
+        {
+          struct tag *t = list_entry (e, struct tag, elem);
+
+          for (j = 0; j < site_cnt; j++)
+            if (sites[j].site == t->site)
+              break;
+          if (j == site_cnt)
+            {
+              if (site_cnt == SITE_CNT)
+                {
+                  other_cnt++;
+                  other_bytes += t->size;
+                  continue;
+                }
+              sites[site_cnt].site = t->site;
+              sites[site_cnt].cnt = sites[site_cnt].bytes = 0;
+              site_cnt++;
+            }
+          sites[j].cnt++;
+          sites[j].bytes += t->size;
+        }
+    }
+  lock_release (&tag_lock);
+
+  qsort (sites, site_cnt, sizeof *sites, compare_site_bytes);
+  printf ("Malloc: live blocks by allocation site\n");
+  for (i = 0; i < site_cnt && i < SITE_PRINT_CNT; i++)
+    printf ("          from %p: %zu blocks, %zu bytes\n",
+            sites[i].site, sites[i].cnt, sites[i].bytes);
+  for (; i < site_cnt; i++)
+    {
+      other_cnt += sites[i].cnt;
+      other_bytes += sites[i].bytes;
+    }
+  if (other_cnt > 0)
+    printf ("          elsewhere: %zu blocks, %zu bytes\n",
+            other_cnt, other_bytes);
+}
+
+/* Prints the live and peak block counts of each size class and,
+   if malloc_track_enabled, the live blocks by allocation site. */
+void
+malloc_print_stats (void)
+{
+  size_t i;
+
+  printf ("Malloc: %-10s %10s %10s %14s\n",
+          "size", "live", "peak", "allocated");
+  for (i = 0; i < desc_cnt; i++)
+    {
+      struct desc *d = &descs[i];
+      enum intr_level old_level = intr_disable ();
+      size_t live = d->live, peak = d->peak;
+      unsigned long long alloc_cnt = d->alloc_cnt;
+      intr_set_level (old_level);
+
+      if (alloc_cnt > 0)
+        printf ("        %10zu %10zu %10zu %14llu\n",
+                d->block_size, live, peak, alloc_cnt);
+    }
+  lock_acquire (&big_lock);
+  printf ("        %10s %10zu %10zu %14llu (pages)\n",
+          "big", big_live_pages, big_peak_pages, big_alloc_cnt);
+  lock_release (&big_lock);
+
+  if (malloc_track_enabled)
+    print_sites ();
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
@@ -274,9 +750,8 @@ block_to_arena (struct block *b)
   ASSERT (a->magic == ARENA_MAGIC);
 
   /* Check that the block is properly aligned for the arena. */
-  ASSERT (a->desc == NULL
-          || (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
-  ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
+  ASSERT (a->desc != NULL);
+  ASSERT ((pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
 
   return a;
 }
@@ -2,12 +2,19 @@
 #define THREADS_MALLOC_H
 
 #include <debug.h>
+#include <stdbool.h>
 #include <stddef.h>
 
+/* If true, malloc() tags each block with its caller, for
+   malloc_print_stats().  Controlled by the kernel command-line
+   option "-memtrack". */
+extern bool malloc_track_enabled;
+
 void malloc_init (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+void malloc_print_stats (void);
 
 #endif /* threads/malloc.h */
@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -31,6 +32,9 @@ struct pool
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    const char *name;                   /* Name, for statistics. */
+    size_t used_cnt;                    /* Pages in use. */
+    size_t peak_cnt;                    /* Most pages ever in use at once. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -82,7 +86,15 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   lock_release (&pool->lock);
 
   if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
+    {
+      enum intr_level old_level = intr_disable ();
+      pool->used_cnt += page_cnt;
+      if (pool->used_cnt > pool->peak_cnt)
+        pool->peak_cnt = pool->used_cnt;
+      intr_set_level (old_level);
+
+      pages = pool->base + PGSIZE * page_idx;
+    }
   else
     pages = NULL;
 
@@ -119,6 +131,7 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 {
   struct pool *pool;
   size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
@@ -139,6 +152,32 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+
+  /* Interrupts, not the pool lock, protect the counters, because
+     a dying thread's page is freed during a thread switch. */
+  old_level = intr_disable ();
+  pool->used_cnt -= page_cnt;
+  intr_set_level (old_level);
+}
+
+/* Prints the page usage of pool P. */
+static void
+print_pool_stats (struct pool *p)
+{
+  enum intr_level old_level = intr_disable ();
+  size_t used_cnt = p->used_cnt, peak_cnt = p->peak_cnt;
+  intr_set_level (old_level);
+
+  printf ("Palloc: %s: %zu of %zu pages in use, peak %zu\n",
+          p->name, used_cnt, bitmap_size (p->used_map), peak_cnt);
+}
+
+/* Prints page usage statistics for both pools. */
+void
+palloc_print_stats (void)
+{
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
 }
 
 /* Frees the page at PAGE. */
@@ -164,9 +203,11 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
+  lock_init_named (&p->lock, name);
   p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
   p->base = base + bm_pages * PGSIZE;
+  p->name = name;
+  p->used_cnt = p->peak_cnt = 0;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -0,0 +1,183 @@
+#include "threads/rcu.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+/* Uniprocessor read-copy-update.
+
+   Time is divided into epochs.  A reader counts itself, in
+   rcu_active[], as a reader of the epoch current when it enters
+   its outermost read section.  Objects passed to call_rcu() wait
+   on rcu_cur until the epoch ends, then on rcu_prev until the
+   next one ends, and then they are safe to reclaim.
+
+   An epoch ends at a context switch, once all the readers of the
+   epoch before it have left their read sections.  Two epoch ends
+   therefore wait for both counters in turn to drain, so every
+   reader that was active when an object was unlinked has
+   finished with it by the time the object is reclaimed.
+
+   Entering and leaving a read section changes only the current
+   thread's nesting depth and, at the outermost level, one
+   counter with a single instruction, so readers never turn
+   interrupts off.  If an epoch ends between a reader's fetching
+   rcu_epoch and counting itself, the reader lands in a counter
+   that a later epoch end still waits on, which is merely
+   conservative.
+
+   Callbacks whose grace period is over run from the next
+   call_rcu() or, so that they do not wait indefinitely for one,
+   from a work item that the epoch end queues.  The epoch end
+   happens inside the scheduler, where waking a worker could
+   recursively yield, so it queues the item with a delay of one
+   tick and lets the timer interrupt wake the worker. */
+
+/* Readers in each of the two most recent epochs. */
+static int rcu_active[2];
+
+/* Current epoch. */
+static unsigned rcu_epoch;
+
+/* Callbacks queued during the current and previous epochs, and
+   callbacks whose grace period is over. */
+static struct list rcu_cur = LIST_INITIALIZER (rcu_cur);
+static struct list rcu_prev = LIST_INITIALIZER (rcu_prev);
+static struct list rcu_done = LIST_INITIALIZER (rcu_done);
+
+/* Runs the callbacks in rcu_done. */
+static struct work rcu_work;
+static bool rcu_work_ready;
+
+static void rcu_reclaim (void);
+
+/* Work function for rcu_work. */
+static void
+rcu_reclaim_work (struct work *w UNUSED)
+{
+  rcu_reclaim ();
+}
+
+/* Prepares to run expired callbacks on the work queue.  Must be
+   called after workqueue_init(). */
+void
+rcu_init (void)
+{
+  work_init (&rcu_work, rcu_reclaim_work, PRI_DEFAULT);
+  rcu_work_ready = true;
+}
+
+/* Enters a read section.  Read sections may nest. */
+void
+rcu_read_lock (void)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->rcu_nesting++ == 0)
+    {
+      cur->rcu_epoch = rcu_epoch;
+      asm volatile ("incl %0" : "+m" (rcu_active[cur->rcu_epoch & 1]));
+    }
+  barrier ();
+}
+
+/* Leaves a read section. */
+void
+rcu_read_unlock (void)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (cur->rcu_nesting > 0);
+
+  barrier ();
+  if (--cur->rcu_nesting == 0)
+    asm volatile ("decl %0" : "+m" (rcu_active[cur->rcu_epoch & 1]));
+}
+
+/* Moves all of the elements of FROM to the end of TO. */
+static void
+move_all (struct list *to, struct list *from)
+{
+  if (!list_empty (from))
+    list_splice (list_end (to), list_begin (from), list_end (from));
+}
+
+/* Runs the callbacks whose grace period is over. */
+static void
+rcu_reclaim (void)
+{
+  for (;;)
+    {
+      enum intr_level old_level = intr_disable ();
+      struct rcu_head *head = NULL;
+
+      if (!list_empty (&rcu_done))
+        head = list_entry (list_pop_front (&rcu_done), struct rcu_head, elem);
+      intr_set_level (old_level);
+
+      if (head == NULL)
+        break;
+      head->func (head);
+    }
+}
+
+/* Arranges for FUNC to be called with HEAD once every read
+   section that began before this call has ended.  The caller
+   must already have unlinked the object containing HEAD, so that
+   no new reader can find it.
+
+   Callbacks run in the context of some later call_rcu(), so FUNC
+   may free memory but should not do much else. */
+void
+call_rcu (struct rcu_head *head, void (*func) (struct rcu_head *))
+{
+  enum intr_level old_level;
+
+  ASSERT (!intr_context ());
+
+  head->func = func;
+  old_level = intr_disable ();
+  list_push_back (&rcu_cur, &head->elem);
+  intr_set_level (old_level);
+
+  rcu_reclaim ();
+}
+
+/* Ends the current epoch if the readers of the previous one have
+   all finished.  Called at each context switch, with interrupts
+   off. */
+void
+rcu_quiescent (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (list_empty (&rcu_cur) && list_empty (&rcu_prev))
+    return;
+  if (rcu_active[(rcu_epoch + 1) & 1] != 0)
+    return;
+
+  move_all (&rcu_done, &rcu_prev);
+  move_all (&rcu_prev, &rcu_cur);
+  rcu_epoch++;
+
+  if (!list_empty (&rcu_done) && rcu_work_ready)
+    work_queue_delayed (&rcu_work, 1);
+}
+
+/* Inserts ELEM at the end of LIST, which readers may be walking
+   concurrently, by completing ELEM before linking it in.  (The
+   plain list_remove() is already safe against readers, since it
+   leaves the removed element's own links intact.)  Writers must
+   still exclude each other. */
+void
+rcu_list_push_back (struct list *list, struct list_elem *elem)
+{
+  struct list_elem *tail = list_end (list);
+
+  elem->prev = tail->prev;
+  elem->next = tail;
+  barrier ();
+  tail->prev->next = elem;
+  tail->prev = elem;
+}
@@ -0,0 +1,44 @@
+#ifndef THREADS_RCU_H
+#define THREADS_RCU_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Read-copy-update.
+
+   Readers of an RCU-protected structure bracket their accesses
+   with rcu_read_lock() and rcu_read_unlock(), which only touch a
+   per-thread counter and never block.  Writers still exclude
+   each other, with a lock, but instead of freeing an object that
+   they have unlinked, they pass it to call_rcu(), which frees it
+   only once every reader that might still see it has left its
+   read section.
+
+   A reader must not sleep inside a read section for long, since
+   that holds up reclamation for everyone. */
+
+/* Deferred callback, embedded in an RCU-protected object. */
+struct rcu_head
+  {
+    struct list_elem elem;              /* List element. */
+    void (*func) (struct rcu_head *);   /* Called after a grace period. */
+  };
+
+/* Converts pointer to rcu_head HEAD into a pointer to the
+   structure that HEAD is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   rcu_head. */
+#define rcu_entry(HEAD, STRUCT, MEMBER)                 \
+        ((STRUCT *) ((uint8_t *) (HEAD)                 \
+                     - offsetof (STRUCT, MEMBER)))
+
+void rcu_init (void);
+void rcu_read_lock (void);
+void rcu_read_unlock (void);
+void call_rcu (struct rcu_head *, void (*func) (struct rcu_head *));
+void rcu_quiescent (void);
+
+void rcu_list_push_back (struct list *, struct list_elem *);
+
+#endif /* threads/rcu.h */
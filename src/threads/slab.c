@@ -0,0 +1,218 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.
+
+   The kernel allocates many objects of a few fixed sizes, such as
+   inodes and open files.  malloc() rounds each of them up to a
+   power of 2, which can waste nearly half of every block.  A slab
+   cache instead divides whole pages into slots of exactly the
+   object's size, after a small header at the start of the page.
+   Free slots in a slab are chained through their first word.
+
+   A cache keeps the slabs that have free slots on its partial
+   list; slabs with no free slots are on no list, since they are
+   found again through the page an object is freed from.  When a
+   slab becomes entirely free, the cache keeps it as a spare if
+   it has none, so that a workload hovering at a slab boundary
+   does not allocate and free a page every time, and otherwise
+   gives the page back to the page allocator. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab header, at the start of each slab's page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* In cache's partial list. */
+    size_t free_cnt;            /* Number of free objects. */
+    void *free;                 /* First free object. */
+  };
+
+/* Offset of the first object in a slab. */
+#define SLAB_OBJ_OFS ROUND_UP (sizeof (struct slab), sizeof (void *))
+
+/* All caches, for slab_print_stats(). */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+/* Initializes cache C for objects of SIZE bytes.  If CTOR is
+   non-null, it is called on each object that slab_alloc()
+   returns.  NAME must remain valid for the kernel's lifetime. */
+void
+slab_cache_init (struct slab_cache *c, const char *name, size_t size,
+                 void (*ctor) (void *))
+{
+  enum intr_level old_level;
+
+  ASSERT (c != NULL);
+  ASSERT (size > 0);
+
+  c->name = name;
+  c->obj_size = ROUND_UP (size < sizeof (void *) ? sizeof (void *) : size,
+                          sizeof (void *));
+  ASSERT (c->obj_size <= PGSIZE - SLAB_OBJ_OFS);
+  c->objs_per_slab = (PGSIZE - SLAB_OBJ_OFS) / c->obj_size;
+  c->ctor = ctor;
+  lock_init_named (&c->lock, name);
+  list_init (&c->partial);
+  c->spare = NULL;
+  c->active = c->peak = 0;
+  c->alloc_cnt = 0;
+  c->slab_cnt = 0;
+  c->reclaim_cnt = 0;
+
+  old_level = intr_disable ();
+  list_push_back (&all_caches, &c->elem);
+  intr_set_level (old_level);
+}
+
+/* Returns a new slab for C with all its objects free, or a null
+   pointer if no page is available. */
+static struct slab *
+slab_create (struct slab_cache *c)
+{
+  struct slab *s = palloc_get_page (0);
+  uint8_t *obj;
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->objs_per_slab;
+  s->free = NULL;
+  obj = (uint8_t *) s + SLAB_OBJ_OFS + c->objs_per_slab * c->obj_size;
+  for (i = 0; i < c->objs_per_slab; i++)
+    {
+      obj -= c->obj_size;
+      *(void **) obj = s->free;
+      s->free = obj;
+    }
+  c->slab_cnt++;
+  return s;
+}
+
+/* Returns the slab that OBJ, an object of C, lies in. */
+static struct slab *
+obj_to_slab (struct slab_cache *c, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+  ASSERT ((pg_ofs (obj) - SLAB_OBJ_OFS) % c->obj_size == 0);
+
+  return s;
+}
+
+/* Allocates and returns an object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+slab_alloc (struct slab_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  ASSERT (c != NULL);
+
+  lock_acquire (&c->lock);
+  if (list_empty (&c->partial))
+    {
+      if (c->spare != NULL)
+        {
+          s = c->spare;
+          c->spare = NULL;
+        }
+      else
+        {
+          s = slab_create (c);
+          if (s == NULL)
+            {
+              lock_release (&c->lock);
+              return NULL;
+            }
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  s = list_entry (list_front (&c->partial), struct slab, elem);
+  obj = s->free;
+  s->free = *(void **) obj;
+  if (--s->free_cnt == 0)
+    list_remove (&s->elem);
+
+  c->alloc_cnt++;
+  if (++c->active > c->peak)
+    c->peak = c->active;
+  lock_release (&c->lock);
+
+  if (c->ctor != NULL)
+    c->ctor (obj);
+  return obj;
+}
+
+/* Frees OBJ, which must have been allocated from cache C. */
+void
+slab_free (struct slab_cache *c, void *obj)
+{
+  struct slab *s;
+
+  ASSERT (c != NULL);
+
+  if (obj == NULL)
+    return;
+  s = obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs. */
+  memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  *(void **) obj = s->free;
+  s->free = obj;
+  if (s->free_cnt++ == 0)
+    list_push_front (&c->partial, &s->elem);
+  if (s->free_cnt == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      if (c->spare == NULL)
+        c->spare = s;
+      else
+        {
+          palloc_free_page (s);
+          c->slab_cnt--;
+          c->reclaim_cnt++;
+        }
+    }
+  c->active--;
+  lock_release (&c->lock);
+}
+
+/* Prints statistics for every slab cache. */
+void
+slab_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+
+      printf ("Slab %s: %zu-byte objects, %zu in use (peak %zu), "
+              "%llu allocated, %zu pages, %llu pages reclaimed\n",
+              c->name, c->obj_size, c->active, c->peak, c->alloc_cnt,
+              c->slab_cnt, c->reclaim_cnt);
+    }
+}
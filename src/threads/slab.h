@@ -0,0 +1,38 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+struct slab;
+
+/* A cache of equally sized objects, carved out of whole pages
+   ("slabs") with no per-object header and no rounding beyond
+   pointer alignment. */
+struct slab_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Bytes per object. */
+    size_t objs_per_slab;       /* Objects in one slab. */
+    void (*ctor) (void *);      /* Run on each allocated object. */
+    struct lock lock;           /* Protects the fields below. */
+    struct list partial;        /* Slabs with free and used objects. */
+    struct slab *spare;         /* One entirely free slab, or NULL. */
+    struct list_elem elem;      /* In the list of all caches. */
+
+    /* Statistics. */
+    size_t active;              /* Objects in use. */
+    size_t peak;                /* Most objects ever in use at once. */
+    unsigned long long alloc_cnt; /* Objects allocated, ever. */
+    size_t slab_cnt;            /* Pages held, including the spare. */
+    unsigned long long reclaim_cnt; /* Pages given back. */
+  };
+
+void slab_cache_init (struct slab_cache *, const char *name, size_t size,
+                      void (*ctor) (void *));
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -30,10 +30,10 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/lockstat.h"
 #include "threads/thread.h"
-#include "threads/malloc.h"
+#include "devices/timer.h"
 
-bool compare_wait_pri(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -64,23 +64,13 @@ void
 sema_down (struct semaphore *sema) 
 {
   enum intr_level old_level;
-	struct thread *cur = thread_current();
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
   while (sema->value == 0) 
-    {
-//#ifdef USERPROG
-//			list_init(&sema->waiters);
-//			list_push_back(&sema->waiters,&cur->elem);
-//#else
-			if (!thread_mlfqs) recalc_pri();
-			list_insert_ordered(&sema->waiters,&cur->elem,compare_pri,(void*)NULL);
-//#endif
-      thread_block();
-    }
+    thread_block_on (&sema->waiters);
   sema->value--;
   intr_set_level (old_level);
 }
@@ -126,11 +116,9 @@ sema_up (struct semaphore *sema)
 
   old_level = intr_disable ();
 	
-	if (list_begin (&sema->waiters) != list_end (&sema->waiters)){
-	  list_sort(&sema->waiters,compare_pri,(void*)NULL);  
+	if (!list_empty (&sema->waiters))
 		thread_unblock (list_entry (list_pop_front (&sema->waiters),
                                 struct thread, elem));
-	}
   sema->value++;
   intr_set_level (old_level);
 	
@@ -174,24 +162,58 @@ sema_test_helper (void *sema_)
     }
 }
 
+/* Atomically makes T the holder of LOCK if LOCK has no holder.
+   Returns true if successful, false if LOCK is already held.
+   A single cmpxchg cannot be split by an interrupt, which is all
+   the atomicity a uniprocessor needs, so this is safe to call
+   with interrupts on. */
+static inline bool
+lock_cas_holder (struct lock *lock, struct thread *t)
+{
+  struct thread *old;
 
-void 
-lock_search_remove(struct list *dl, struct lock *lock)
+  asm volatile ("cmpxchgl %2, %1"
+                : "=a" (old), "+m" (lock->holder)
+                : "r" (t), "0" (NULL)
+                : "cc", "memory");
+  return old == NULL;
+}
+
+/* Returns the highest priority among the threads on WAITERS, a
+   list maintained by thread_block_on(), or PRI_MIN - 1 if there
+   are none.  Interrupts must be off. */
+static int
+waiters_priority (struct list *waiters)
 {
-	struct list_elem *begin = list_begin(dl);
-	if (begin != list_end(dl)){
-		struct list_elem *e;
-		struct donate *de;
-			
-		for (e = begin; e != list_end(dl); e = list_next(e))
-		{
-			de = list_entry(e,struct donate,elem);
-			if(de->l == lock)
-			{
-				list_remove(e);
-			}
-		}
-	}
+  if (list_empty (waiters))
+    return PRI_MIN - 1;
+  return list_entry (list_front (waiters), struct thread, elem)->priority;
+}
+
+/* Lets the threads still waiting on LOCK, which the current
+   thread has just taken, donate through it to the new holder.
+   Interrupts must be off. */
+static void
+lock_take (struct lock *lock)
+{
+  struct thread *cur = thread_current ();
+  int priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (lock->holder == cur);
+
+  if (thread_mlfqs)
+    return;
+
+  /* A waiter may already have donated to us, and so put LOCK on
+     our held_locks, between our taking LOCK and getting here. */
+  priority = waiters_priority (&lock->waiters);
+  if (lock->priority < PRI_MIN && priority >= PRI_MIN)
+    list_push_back (&cur->held_locks, &lock->elem);
+  if (lock->priority < priority)
+    lock->priority = priority;
+  if (lock->priority > cur->priority)
+    thread_refresh_priority ();
 }
 
 /* Initializes LOCK.  A lock can be held by at most a single
@@ -211,22 +233,38 @@ lock_search_remove(struct list *dl, struct lock *lock)
    instead of a lock. */
 void
 lock_init (struct lock *lock)
+{
+  lock_init_named (lock, NULL);
+}
+
+/* Initializes LOCK as lock_init() does, naming it NAME.  When
+   lockstat is enabled, all the locks with a given name share one
+   set of contention statistics.  NAME must remain valid for the
+   kernel's lifetime. */
+void
+lock_init_named (struct lock *lock, const char *name)
 {
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
-  sema_init (&lock->semaphore, 1);
+  lock->priority = PRI_MIN - 1;
+  list_init (&lock->waiters);
+  lock->stat = lockstat_lookup (name);
+  lock->stat_since = 0;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   An uncontended acquire is a single atomic compare-and-swap of
+   LOCK's holder.  Only when that fails do we turn interrupts
+   off, join the waiters and donate our priority.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
-
 void
 lock_acquire (struct lock *lock)
 {
@@ -234,25 +272,39 @@ lock_acquire (struct lock *lock)
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-	struct thread *holder = lock->holder;
 	struct thread *cur = thread_current();
-	struct donate *e;
-
-	if(holder != NULL){
-		e = (struct donate *)malloc(sizeof(struct donate));
-		e->l = lock;
-		e->donator = cur;
-		list_push_back(&holder->donate_list,&e->elem);
-		recalc_pri();
-	}
+	enum intr_level old_level;
+	int64_t wait_start = 0;
 
-  sema_down (&lock->semaphore);			
+	if(lock_cas_holder (lock, cur) && list_empty (&lock->waiters)){
+		if(lock->stat != NULL)
+			lockstat_acquired (lock, NULL, 0);
+		return;
+	}
 
-	if(holder != NULL){
-		list_remove(&e->elem);
+	old_level = intr_disable ();
+	while(lock->holder != cur && !lock_cas_holder (lock, cur)){
+		/* Donate our priority down the chain of lock holders before
+		   blocking, so that whoever is in our way runs at least at
+		   our priority.  A releaser wakes one waiter, which then has
+		   to win the lock against anyone who got there first. */
+		if(wait_start == 0)
+			wait_start = timer_ns ();
+		if(!thread_mlfqs){
+			cur->wait_on_lock = lock;
+			thread_donate_priority (cur);
+		}
+		thread_block_on (&lock->waiters);
 	}
 
-	lock->holder = cur;
+	if(wait_start != 0)
+		cur->sched.lock_ns += timer_ns () - wait_start;
+	cur->wait_on_lock = NULL;
+	lock_take (lock);
+	if(lock->stat != NULL)
+		lockstat_acquired (lock, wait_start != 0 ? __builtin_return_address (0)
+											 : NULL, timer_ns () - wait_start);
+	intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -264,19 +316,56 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
-  bool success;
+  enum intr_level old_level;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
-  success = sema_try_down (&lock->semaphore);
-  if (success)
-    lock->holder = thread_current ();
-  return success;
+  if (!lock_cas_holder (lock, thread_current ()))
+    return false;
+  if (!list_empty (&lock->waiters))
+    {
+      old_level = intr_disable ();
+      lock_take (lock);
+      intr_set_level (old_level);
+    }
+  if (lock->stat != NULL)
+    lockstat_acquired (lock, NULL, 0);
+  return true;
+}
+
+/* Releases LOCK and wakes its highest priority waiter, if any,
+   without yielding to it.  Returns true if a waiter was woken.
+   Interrupts must be off. */
+static bool
+lock_unlock (struct lock *lock)
+{
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (lock->stat != NULL)
+		lockstat_released (lock);
+	lock->holder = NULL;
+	if (lock->priority >= PRI_MIN)
+	{
+		/* Give back whatever was donated through LOCK. */
+		list_remove (&lock->elem);
+		lock->priority = PRI_MIN - 1;
+		thread_refresh_priority ();
+	}
+	if (list_empty (&lock->waiters))
+		return false;
+	thread_unblock (list_entry (list_pop_front (&lock->waiters),
+															struct thread, elem));
+	return true;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
 
+   If nobody waits on LOCK, this only clears the holder.  The
+   check and the clear happen with interrupts off, so that a
+   thread cannot join the waiters between them and sleep
+   forever.
+
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
@@ -286,10 +375,12 @@ lock_release (struct lock *lock)
 	ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
-	lock_search_remove(&thread_current()->donate_list, lock);
-  
-	lock->holder = NULL;
-  sema_up (&lock->semaphore);
+	enum intr_level old_level = intr_disable ();
+	bool woke = lock_unlock (lock);
+	intr_set_level (old_level);
+
+	if (woke)
+		checkCurrentThreadPriority ();
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -303,23 +394,206 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
+/* Initializes RW.  Any number of threads may hold an rwlock for
+   reading at once, or a single thread may hold it for writing.
+   Writers take precedence: once a writer waits, new readers wait
+   behind it, so a steady stream of readers cannot starve it.
 
+   Every holder of an rwlock receives the priority of its highest
+   priority waiter, so a writer waiting on several readers raises
+   all of them.  A thread may hold at most RWLOCK_HOLD_MAX rwlocks
+   at a time.  Like locks, rwlocks are not recursive. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  list_init (&rw->holders);
+  rw->writing = false;
+  rw->writers_waiting = 0;
+  list_init (&rw->read_waiters);
+  list_init (&rw->write_waiters);
+  rw->priority = PRI_MIN - 1;
+}
 
-/* One semaphore in a list. */
-struct semaphore_elem 
-  {
-    struct list_elem elem;              /* List element. */
-    struct semaphore semaphore;         /* This semaphore. */
-		int priority;
-	};
-
-bool 
-compare_wait_pri(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
+/* Returns the current thread's hold on RW, or, if RW is a null
+   pointer, an unused hold.  Returns a null pointer if there is
+   none. */
+static struct rwlock_hold *
+rwlock_find_hold (const struct rwlock *rw)
 {
-	return list_entry(a,struct semaphore_elem, elem)->priority	
-		   > list_entry(b,struct semaphore_elem, elem)->priority;
+  struct thread *cur = thread_current ();
+  int i;
 
+  for (i = 0; i < RWLOCK_HOLD_MAX; i++)
+    if (cur->rwlock_holds[i].rwlock == rw)
+      return &cur->rwlock_holds[i];
+  return NULL;
 }
+
+/* Blocks the current thread on WAITERS, one of RW's waiter
+   lists, after donating its priority to every holder of RW.
+   Interrupts must be off. */
+static void
+rwlock_wait (struct rwlock *rw, struct list *waiters)
+{
+  struct thread *cur = thread_current ();
+  int64_t wait_start = timer_ns ();
+
+  if (!thread_mlfqs)
+    {
+      cur->wait_on_rwlock = rw;
+      thread_donate_priority (cur);
+    }
+  thread_block_on (waiters);
+  cur->wait_on_rwlock = NULL;
+  cur->sched.lock_ns += timer_ns () - wait_start;
+}
+
+/* Makes the current thread a holder of RW, which then donates to
+   it on behalf of RW's waiters.  Interrupts must be off. */
+static void
+rwlock_take (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  struct rwlock_hold *hold = rwlock_find_hold (NULL);
+
+  ASSERT (hold != NULL);
+
+  hold->rwlock = rw;
+  hold->thread = cur;
+  list_push_back (&rw->holders, &hold->elem);
+  if (!thread_mlfqs && rw->priority > cur->priority)
+    thread_refresh_priority ();
+}
+
+/* Acquires RW for reading, sleeping until no writer holds it or
+   waits for it.  The current thread must not already hold RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_by_current_thread (rw));
+
+  old_level = intr_disable ();
+  while (rw->writing || rw->writers_waiting > 0)
+    rwlock_wait (rw, &rw->read_waiters);
+  rwlock_take (rw);
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  The current thread must not already hold RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_by_current_thread (rw));
+
+  old_level = intr_disable ();
+  rw->writers_waiting++;
+  while (!list_empty (&rw->holders))
+    rwlock_wait (rw, &rw->write_waiters);
+  rw->writers_waiting--;
+  rw->writing = true;
+  rwlock_take (rw);
+  intr_set_level (old_level);
+}
+
+/* Gives up the current thread's hold on RW.  When the last holder
+   leaves, wakes the highest priority waiting writer if there is
+   one, or else every waiting reader. */
+static void
+rwlock_release (struct rwlock *rw)
+{
+  struct rwlock_hold *hold = rwlock_find_hold (rw);
+  enum intr_level old_level;
+  bool woke = false;
+
+  old_level = intr_disable ();
+  list_remove (&hold->elem);
+  hold->rwlock = NULL;
+  rw->writing = false;
+  if (list_empty (&rw->holders))
+    {
+      if (!list_empty (&rw->write_waiters))
+        {
+          thread_unblock (list_entry (list_pop_front (&rw->write_waiters),
+                                      struct thread, elem));
+          woke = true;
+        }
+      else
+        while (!list_empty (&rw->read_waiters))
+          {
+            thread_unblock (list_entry (list_pop_front (&rw->read_waiters),
+                                        struct thread, elem));
+            woke = true;
+          }
+
+      /* Whoever is still waiting donates to the next holders. */
+      rw->priority = PRI_MIN - 1;
+      if (!thread_mlfqs)
+        {
+          int readers = waiters_priority (&rw->read_waiters);
+          int writers = waiters_priority (&rw->write_waiters);
+          rw->priority = readers > writers ? readers : writers;
+        }
+    }
+  if (!thread_mlfqs)
+    thread_refresh_priority ();
+  intr_set_level (old_level);
+
+  if (woke)
+    checkCurrentThreadPriority ();
+}
+
+/* Releases RW, which the current thread must hold for reading. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_by_current_thread (rw));
+  ASSERT (!rw->writing);
+
+  rwlock_release (rw);
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_by_current_thread (rw));
+  ASSERT (rw->writing);
+
+  rwlock_release (rw);
+}
+
+/* Returns true if the current thread holds RW, for reading or
+   writing, false otherwise. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rwlock_find_hold (rw) != NULL;
+}
+
+
+
+/* One semaphore in a list. */
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -347,6 +621,11 @@ cond_init (struct condition *cond)
    condition variables.  That is, there is a one-to-many mapping
    from locks to condition variables.
 
+   A signaled waiter is not woken right away.  It moves straight
+   to LOCK's waiters, which the signaler holds, and wakes only
+   when LOCK is released to it, so a broadcast does not wake a
+   herd of threads just to have them block again on LOCK.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -354,23 +633,45 @@ cond_init (struct condition *cond)
 void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
-  struct semaphore_elem waiter;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
-  
-  sema_init (&waiter.semaphore, 0);
 
-	waiter.priority = thread_get_priority();
+  /* With interrupts off, nobody can signal COND between our
+     releasing LOCK and joining COND's waiters. */
+  old_level = intr_disable ();
+  lock_unlock (lock);
+  thread_block_on (&cond->waiters);
+  cur->wait_on_lock = NULL;
+  intr_set_level (old_level);
 
-  list_insert_ordered(&cond->waiters, &waiter.elem,compare_wait_pri,(void*)NULL);
-	lock_release (lock);
-  sema_down (&waiter.semaphore);
   lock_acquire (lock);
 }
 
+/* Moves the highest priority waiter on COND to the waiters of
+   LOCK, which the current thread holds, and has it donate to us
+   like any other waiter on LOCK.  Interrupts must be off. */
+static void
+cond_requeue (struct condition *cond, struct lock *lock)
+{
+  struct thread *t = list_entry (list_pop_front (&cond->waiters),
+                                 struct thread, elem);
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->wait_list = &lock->waiters;
+  list_insert_ordered (&lock->waiters, &t->elem, compare_pri, NULL);
+  if (!thread_mlfqs)
+    {
+      t->wait_on_lock = lock;
+      thread_donate_priority (t);
+    }
+}
+
 /* If any threads are waiting on COND (protected by LOCK), then
    this function signals one of them to wake up from its wait.
    LOCK must be held before calling this function.
@@ -381,18 +682,23 @@ cond_wait (struct condition *cond, struct lock *lock)
 void
 cond_signal (struct condition *cond, struct lock *lock) 
 {
+  enum intr_level old_level;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    cond_requeue (cond, lock);
+  intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
-   LOCK).  LOCK must be held before calling this function.
+   LOCK).  LOCK must be held before calling this function.  The
+   threads queue on LOCK, and each release of LOCK then wakes
+   only the one that gets it.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
@@ -400,9 +706,15 @@ cond_signal (struct condition *cond, struct lock *lock)
 void
 cond_broadcast (struct condition *cond, struct lock *lock) 
 {
+  enum intr_level old_level;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   while (!list_empty (&cond->waiters))
-    cond_signal (cond, lock);
+    cond_requeue (cond, lock);
+  intr_set_level (old_level);
 }
@@ -3,12 +3,14 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct list waiters;        /* Waiting threads, highest priority
+                                   first. */
 	};
 
 void sema_init (struct semaphore *, unsigned value);
@@ -20,20 +22,58 @@ void sema_self_test (void);
 /* Lock. */
 struct lock 
   {
-    struct thread *holder;      /* Thread holding lock (for debugging). */
-    struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct thread *holder;      /* Thread holding lock, set atomically. */
+    struct list waiters;        /* Threads waiting to acquire the lock,
+                                   highest priority first. */
+    struct list_elem elem;      /* Element in holder's held_locks. */
+    int priority;               /* Highest priority donated through this
+                                   lock, or PRI_MIN - 1 if none, in
+                                   which case it is not on held_locks. */
+    struct lockstat *stat;      /* Contention statistics, or NULL. */
+    int64_t stat_since;         /* When last acquired, if STAT. */
   };
 
 void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Reader-writer lock. */
+struct rwlock
+  {
+    struct list holders;        /* rwlock_holds of current holders. */
+    bool writing;               /* Held exclusively? */
+    unsigned writers_waiting;   /* Writers in rwlock_acquire_write(). */
+    struct list read_waiters;   /* Threads waiting for shared access. */
+    struct list write_waiters;  /* Threads waiting for exclusive access. */
+    int priority;               /* Highest priority donated through this
+                                   rwlock, or PRI_MIN - 1 if none. */
+  };
+
+/* A thread's hold on an rwlock.  Each thread has a few of these,
+   so that a waiter can donate to every current reader and each
+   reader can see what was donated to it. */
+struct rwlock_hold
+  {
+    struct rwlock *rwlock;      /* Held rwlock, or NULL if unused. */
+    struct thread *thread;      /* Holding thread. */
+    struct list_elem elem;      /* Element in rwlock's holders. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct list waiters;        /* Waiting threads, highest priority
+                                   first. */
   };
 
 void cond_init (struct condition *);
@@ -41,8 +81,6 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
-void lock_search_remove(struct list *dl, struct lock *lock);
-
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
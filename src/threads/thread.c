@@ -8,6 +8,7 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/rcu.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -26,20 +27,36 @@
 //#define Q 14
 #define F 16384
 
-struct list child_info_list;
-
 static int gl_load_avg;
 
-//static struct list mlfqs_queues[PRI_MAX+1];
-
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running, kept as one FIFO queue
+   per priority.  Bit P of ready_bitmap is set if and only if
+   ready_queues[P] is nonempty, so the highest-priority ready
+   thread can be found without scanning.  Accessed only with
+   interrupts off. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static size_t ready_cnt;        /* Total number of ready threads. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
+/* All processes, hashed by tid for getThreadFromTid().  A fixed
+   array of buckets is used rather than lib/kernel/hash.c because
+   threads are removed with interrupts off, when the table could
+   not be resized with malloc(). */
+#define TID_BUCKET_CNT 64
+static struct list tid_buckets[TID_BUCKET_CNT];
+
+/* Returns the tid_buckets[] list that holds the thread with TID. */
+static inline struct list *
+tid_bucket (tid_t tid)
+{
+  return &tid_buckets[(unsigned) tid % TID_BUCKET_CNT];
+}
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -62,6 +79,18 @@ static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
 
+/* Pages of exited threads, kept for reuse by thread_create() so
+   that creating and reaping threads does not go through the page
+   allocator's bitmap each time.  Pages are linked through their
+   first word.  Accessed only with interrupts off. */
+#define THREAD_PAGE_CACHE_MAX 16
+static void *thread_page_cache;
+static size_t thread_page_cache_cnt;
+
+/* Time from thread_unblock() until the thread runs.  Updated
+   with interrupts off. */
+static struct schedlat sched_latency;
+
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
@@ -82,13 +111,19 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static void *thread_page_get (void);
+static void thread_page_put (void *);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static int ready_max_priority (void);
+static void set_priority (struct thread *, int priority);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queues and the tid lock.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -100,12 +135,18 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
-	//int i;
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
-  list_init (&ready_list);
+  lock_init_named (&tid_lock, "tid");
+  for (i = PRI_MIN; i <= PRI_MAX; i++)
+    list_init (&ready_queues[i]);
+  ready_bitmap = 0;
+  ready_cnt = 0;
   list_init (&all_list);
+  for (i = 0; i < TID_BUCKET_CNT; i++)
+    list_init (&tid_buckets[i]);
 
 	if(thread_mlfqs){
 		gl_load_avg = 0;
@@ -115,15 +156,13 @@ thread_init (void)
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  list_push_back (tid_bucket (initial_thread->tid), &initial_thread->tidelem);
 
 	if(thread_mlfqs){
 		initial_thread->nice = 0;
 		initial_thread->recent_cpu = 0;
 	}
 
-#ifdef USERPROG
-	list_init(&child_info_list);
-#endif
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -169,15 +208,24 @@ thread_tick (void)
 
 	if (thread_mlfqs)
 	{
+		int64_t now = timer_ticks();
+
 		inc_recent_cpu();		// at each interrupt, inc recent_cpu 
-		if(timer_ticks() % TIMER_FREQ == 0)
+		if(now % TIMER_FREQ == 0)
 		{
-			recalc_cpu();
+			/* load_avg first: the recent_cpu decay uses the new value. */
 			recalc_load();
+			recalc_cpu();
 		}
-		if(timer_ticks() % 4 == 0)
+		else if(now % 4 == 0)
 		{
-			recalc_pri();
+			/* Between once-a-second updates only the running thread's
+			   recent_cpu changes, so it is the only thread whose
+			   priority can have moved. */
+			if (t != idle_thread)
+				set_priority (t, mlfqs_calc_pri(t));
+			if (ready_max_priority () > t->priority)
+				intr_yield_on_return ();
 		}
 	}
 }
@@ -188,25 +236,23 @@ void checkCurrentThreadPriority()
 //#ifdef USERPROG
 //	thread_yield();
 //#else
-	if(!list_empty(&ready_list)){
-		
-		if(list_begin(&ready_list) != list_end(&ready_list)){
-			enum intr_level old_level = intr_disable();
-			struct thread *frontT = list_entry(list_front(&ready_list),struct thread,elem);
+	enum intr_level old_level = intr_disable();
+	int best = ready_max_priority();
+
+	if(best >= PRI_MIN){
 //#ifdef USERPROG
-//			if(thread_get_priority() <= frontT->priority)
+//		if(thread_get_priority() <= best)
 //#else 
-			if(thread_get_priority() < frontT->priority)
+		if(thread_get_priority() < best)
 //#endif
-			{
-				if(intr_context())
-					intr_yield_on_return();
-				else
-					thread_yield();
-			}
-			intr_set_level(old_level);
+		{
+			if(intr_context())
+				intr_yield_on_return();
+			else
+				thread_yield();
 		}
 	}
+	intr_set_level(old_level);
 //#endif
 }
 
@@ -218,6 +264,36 @@ thread_print_stats (void)
           idle_ticks, kernel_ticks, user_ticks);
 }
 
+/* Credits N timer ticks, which passed without timer interrupts
+   while the CPU was idle, to the idle time statistics. */
+void
+thread_idle_ticks (int64_t n)
+{
+  idle_ticks += n;
+}
+
+/* Copies T's scheduler statistics into *STATS.  If T is
+   running, its current time slice is included in the run time. */
+void
+thread_get_schedstat (struct thread *t, struct schedstat *stats)
+{
+  enum intr_level old_level = intr_disable ();
+
+  *stats = t->sched;
+  if (t->status == THREAD_RUNNING)
+    stats->run_ns += timer_ns () - t->sched_since;
+  intr_set_level (old_level);
+}
+
+/* Copies the scheduling latency histogram into *LAT. */
+void
+thread_get_schedlat (struct schedlat *lat)
+{
+  enum intr_level old_level = intr_disable ();
+  *lat = sched_latency;
+  intr_set_level (old_level);
+}
+
 /* Creates a new kernel thread named NAME with the given initial
    PRIORITY, which executes FUNCTION passing AUX as the argument,
    and adds it to the ready queue.  Returns the thread identifier
@@ -247,7 +323,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_get ();
   if (t == NULL)
 	{
     return TID_ERROR;
@@ -262,6 +338,8 @@ thread_create (const char *name, int priority,
      member cannot be observed. */
   old_level = intr_disable ();
 
+  list_push_back (tid_bucket (tid), &t->tidelem);
+
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
   kf->eip = NULL;
@@ -282,6 +360,10 @@ thread_create (const char *name, int priority,
 	if(thread_mlfqs){
 		t->recent_cpu = thread_current()->recent_cpu;
 		t->nice = thread_current()->nice;
+		/* The 4-tick refresh only updates the running thread, so
+		   compute the new thread's priority here rather than
+		   queueing it at the caller's PRIORITY. */
+		t->priority = mlfqs_calc_pri(t);
 	}
   /* Add to run queue. */
 
@@ -310,6 +392,26 @@ thread_block (void)
   schedule ();
 }
 
+/* Puts the current thread to sleep on WAITERS, a list of threads
+   kept in descending order of priority, until thread_unblock()
+   wakes it.  If the thread's priority changes while it waits, it
+   moves to its new place in WAITERS, so the front of WAITERS is
+   always its highest priority thread.
+
+   Interrupts must be turned off when calling this function. */
+void
+thread_block_on (struct list *waiters)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (!intr_context ());
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  cur->wait_list = waiters;
+  list_insert_ordered (waiters, &cur->elem, compare_pri, NULL);
+  thread_block ();
+}
+
 /* Transitions a blocked thread T to the ready-to-run state.
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
@@ -330,9 +432,11 @@ thread_unblock (struct thread *t)
   
 	ASSERT (t->status == THREAD_BLOCKED);
 
-	list_insert_ordered(&ready_list,&t->elem,compare_pri,(void*)NULL);
-	
 	t->status = THREAD_READY;
+	t->wait_list = NULL;
+	t->sched_since = timer_ns ();
+	t->sched_woken = true;
+	ready_push (t);
 
 	intr_set_level (old_level);
 
@@ -386,6 +490,7 @@ void
 thread_exit (void) 
 {
   ASSERT (!intr_context ());
+  ASSERT (thread_current ()->rcu_nesting == 0);
 
 #ifdef USERPROG
 		process_exit ();
@@ -400,6 +505,7 @@ thread_exit (void)
 //	printf("%s: exit(%d)\n",cur->name,getCIFromTid(cur->tid)->exitCode);
 //#endif
 	list_remove (&thread_current()->allelem);
+	list_remove (&thread_current()->tidelem);
 	thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -416,11 +522,9 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread) 
-	{
-		list_insert_ordered(&ready_list,&cur->elem,compare_pri,(void*)NULL);
-	}
   cur->status = THREAD_READY;
+  if (cur != idle_thread) 
+		ready_push (cur);
   schedule ();
   intr_set_level (old_level);
 }
@@ -450,70 +554,31 @@ inc_recent_cpu()
 			t->recent_cpu = addxn(t->recent_cpu,1);
 }
 
-void
-recalc_pri()
-{
-	unsigned int i;
-	if(!thread_mlfqs){
-	for (i = 0; i < list_size(&all_list); i++){
-		list_sort(&all_list,compare_pri,(void*)NULL);
-		struct list_elem *ae = list_begin(&all_list);
-		for (;ae != list_end(&all_list); ae = list_next(ae))
-		{
-			struct thread *t = list_entry(ae,struct thread,allelem);
-			struct list *dl = &t->donate_list;
-			int final_priority = t->priority;
-
-			if(list_begin(dl) != list_end(dl))
-			{
-				struct list_elem *e;
-				for (e = list_begin(dl); e != list_end(dl); e = list_next(e))
-				{
-		
-				int max_donate_priority = list_entry(e,struct donate,elem)->donator->priority;
-				if (max_donate_priority > final_priority)
-					final_priority = max_donate_priority;
-				}
-
-			}
-			t->priority = final_priority;
-		}
-	}
-	} else {	// mlfqs
-			struct list_elem *e = list_begin(&all_list);
-			for(;e!=list_end(&all_list);e = list_next(e))
-			{
-				struct thread *t = list_entry(e,struct thread, allelem);
-
-				if (t == idle_thread) continue;
-
-				int oPriority = t->priority;
-				int nPriority = mlfqs_calc_pri(t);
-				if (oPriority != nPriority){
-					t->priority = nPriority;
-					list_sort(&ready_list,compare_pri,(void*)NULL);
-				}
-			}
-			checkCurrentThreadPriority();
-		}
-}
-
-
+/* Decays every thread's recent_cpu by (2*load_avg)/(2*load_avg + 1)
+   and adds its nice value, then recomputes its priority.  The
+   decay factor is the same for all threads, so it is computed
+   once and applied with a single fixed-point multiply per
+   thread. */
 void 
 recalc_cpu(){
   struct list_elem *e = list_begin(&all_list);
+	int twice_load = mulxn(gl_load_avg,2);
+	int decay = divxy(twice_load,addxn(twice_load,1));
 	struct thread *t;
+
 	for(;e != list_end(&all_list);e = list_next(e))
 	{
 		t = list_entry(e,struct thread, allelem);
-		if(t != idle_thread)
-		t->recent_cpu = addxn(mulxy(divxy(mulxy(con_ntof(2),gl_load_avg),addxn(mulxy(con_ntof(2),gl_load_avg),1)),t->recent_cpu),t->nice);
+		if(t == idle_thread) continue;
+		t->recent_cpu = addxn(mulxy(decay,t->recent_cpu),t->nice);
+		set_priority (t, mlfqs_calc_pri(t));
 	}
+	checkCurrentThreadPriority();
 }
 
 int 
 getReadyThread(){
-	int num = list_size(&ready_list);
+	int num = ready_cnt;
 	
 	if (thread_current() != idle_thread) return num+1;
 	else return num;
@@ -526,53 +591,118 @@ recalc_load(){
 	gl_load_avg = load_avg;
 }
 
-int
-search_best_donator(struct list *dl)
+/* Maximum number of lock holders that a single donation passes
+   through.  Bounds the work done on each contended acquire, and
+   keeps a cycle of waiting threads (a deadlock) from looping
+   forever. */
+#define DONATE_DEPTH_MAX 8
+
+static void donate_to (struct thread *holder, int priority, int depth);
+
+/* Donates PRIORITY from T to the holder of the lock T waits on,
+   or to every holder of the rwlock T waits on.  DEPTH is the
+   number of holders already passed through. */
+static void
+donate_priority (struct thread *t, int priority, int depth)
 {
-	struct list_elem *begin = list_begin(dl);
-	int max = PRI_MIN;
-	int pri;
-	
-	if (list_begin(dl) != list_end(dl))	// not empty
+	struct lock *lock = t->wait_on_lock;
+	struct rwlock *rw = t->wait_on_rwlock;
+	struct list_elem *e;
+
+	if (depth >= DONATE_DEPTH_MAX)
+		return;
+
+	if (lock != NULL && lock->holder != NULL)
 	{
-		struct list_elem *e;
-		struct donate *de;
-			
-		for (e = begin; e != list_end(dl); e = list_next(e))
-		{
-			de = list_entry(e,struct donate,elem);
-			
-			pri = de->donator->priority;
-		if( max < pri)
-			max = pri;
-		}
+		if (lock->priority < PRI_MIN)
+			list_push_back (&lock->holder->held_locks, &lock->elem);
+		if (lock->priority < priority)
+			lock->priority = priority;
+		donate_to (lock->holder, priority, depth);
+	}
+	else if (rw != NULL)
+	{
+		if (rw->priority < priority)
+			rw->priority = priority;
+		for (e = list_begin (&rw->holders); e != list_end (&rw->holders);
+				 e = list_next (e))
+			donate_to (list_entry (e, struct rwlock_hold, elem)->thread,
+								 priority, depth);
 	}
-	return max;
 }
 
+/* Raises HOLDER to PRIORITY, then passes the donation on to
+   whatever HOLDER itself waits on. */
+static void
+donate_to (struct thread *holder, int priority, int depth)
+{
+	if (holder->priority >= priority)
+		return;
+	set_priority (holder, priority);
+	donate_priority (holder, priority, depth + 1);
+}
+
+/* Donates T's priority to the holder of the lock it is about to
+   wait on, or to all holders of the rwlock, then
+   on down the chain of holders that are themselves waiting,
+   stopping wherever a holder already runs at least at the
+   donated priority.  Each lock or rwlock along the way remembers
+   the highest priority donated through it, so that a holder can
+   recompute its own priority from what it holds when it releases
+   one.  A lock joins its holder's held_locks only when the first
+   donation passes through it, so that uncontended locks never
+   touch the list.  Interrupts must be off. */
+void
+thread_donate_priority (struct thread *t)
+{
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	donate_priority (t, t->priority, 0);
+}
+
+/* Recomputes the current thread's effective priority from its
+   base priority and the priorities donated through the locks and
+   rwlocks it still holds.  Interrupts must be off. */
+void
+thread_refresh_priority (void)
+{
+	struct thread *cur = thread_current ();
+	int priority = cur->oPriority;
+	struct list_elem *e;
+	int i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (&cur->held_locks); e != list_end (&cur->held_locks);
+			 e = list_next (e))
+	{
+		struct lock *lock = list_entry (e, struct lock, elem);
+		if (lock->priority > priority)
+			priority = lock->priority;
+	}
+	for (i = 0; i < RWLOCK_HOLD_MAX; i++)
+	{
+		struct rwlock *rw = cur->rwlock_holds[i].rwlock;
+		if (rw != NULL && rw->priority > priority)
+			priority = rw->priority;
+	}
+	set_priority (cur, priority);
+}
 
 /* Sets the current thread's priority to NEW_PRIORITY. */
 void
 thread_set_priority (int new_priority) 
 {
+	enum intr_level old_level;
+
 	ASSERT(!thread_mlfqs);
-	struct thread *cur = thread_current();
-	struct list *dl = &cur->donate_list;
-	
-	if(list_begin(dl) != list_end(dl))
-	{
-		//int max_donate_priority = list_entry(list_front(al),struct donate,elem)->dPriority;
-		int max_donate_priority = search_best_donator(dl);
-		if (max_donate_priority > new_priority)
-		{	
-			cur->priority = max_donate_priority;				
-			cur->oPriority = new_priority;	
-		}	
-	} else {
-		cur->oPriority = cur->priority = new_priority;
-	}
-	checkCurrentThreadPriority();
 
+	old_level = intr_disable ();
+	thread_current ()->oPriority = new_priority;
+	thread_refresh_priority ();
+	intr_set_level (old_level);
+
+	checkCurrentThreadPriority();
 }
 
 int
@@ -581,6 +711,8 @@ mlfqs_calc_pri(struct thread* t)
 	int mid = con_xton_near(divxn(t->recent_cpu,4));
 	int back = (t->nice)*2;
 	int pri = PRI_MAX - mid - back;
+	if (pri < PRI_MIN) pri = PRI_MIN;
+	if (pri > PRI_MAX) pri = PRI_MAX;
 	return pri;
 }
 
@@ -590,23 +722,8 @@ thread_get_priority (void)
 {
  	struct thread *cur = thread_current();
 
-	if(!thread_mlfqs){
-	struct list *dl = &cur->donate_list;
-	
-	int final_priority = cur->oPriority;
-
-	if(list_begin(dl) != list_end(dl))
-	{
-		int max_donate_priority = search_best_donator(dl);
-		if (max_donate_priority > final_priority)
-		{
-			final_priority = max_donate_priority;
-		}
-	}
-	
-	cur->priority = final_priority;
-	return final_priority;
-	}
+	if(!thread_mlfqs)
+		return cur->priority;
 	else {
 		cur->priority = mlfqs_calc_pri(cur);
 		return cur->priority;
@@ -673,6 +790,10 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nothing is ready to run, so the periodic timer may stop
+         until the next deadline. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -736,8 +857,9 @@ init_thread (struct thread *t, const char *name, int priority)
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = t->oPriority = priority;		// modified
   t->magic = THREAD_MAGIC;
-	list_init(&t->donate_list);
-  list_insert_ordered (&all_list, &t->allelem,compare_pri,(void *)NULL);
+	list_init(&t->held_locks);
+	list_init(&t->children);
+  list_push_back (&all_list, &t->allelem);
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -753,6 +875,77 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
+/* Adds ready thread T to the back of the run queue for its
+   priority. */
+static void
+ready_push (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  list_push_back (&ready_queues[t->priority], &t->elem);
+  ready_bitmap |= (uint64_t) 1 << t->priority;
+  ready_cnt++;
+}
+
+/* Removes ready thread T from the run queue for its priority. */
+static void
+ready_remove (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[t->priority]))
+    ready_bitmap &= ~((uint64_t) 1 << t->priority);
+  ready_cnt--;
+}
+
+/* Returns the priority of the highest-priority nonempty run
+   queue, or PRI_MIN - 1 if no thread is ready. */
+static int
+ready_max_priority (void)
+{
+  uint32_t hi = ready_bitmap >> 32;
+  uint32_t lo = ready_bitmap;
+
+  if (hi != 0)
+    return 63 - __builtin_clz (hi);
+  else if (lo != 0)
+    return 31 - __builtin_clz (lo);
+  else
+    return PRI_MIN - 1;
+}
+
+/* Changes T's effective priority to PRIORITY.  If T is ready,
+   moves it to the back of the run queue for its new priority. */
+static void
+set_priority (struct thread *t, int priority)
+{
+  enum intr_level old_level;
+
+  if (t->priority == priority)
+    return;
+
+  old_level = intr_disable ();
+  if (t->status == THREAD_READY)
+    {
+      ready_remove (t);
+      t->priority = priority;
+      ready_push (t);
+    }
+  else if (t->status == THREAD_BLOCKED && t->wait_list != NULL)
+    {
+      list_remove (&t->elem);
+      t->priority = priority;
+      list_insert_ordered (t->wait_list, &t->elem, compare_pri, NULL);
+    }
+  else
+    t->priority = priority;
+  intr_set_level (old_level);
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
@@ -761,8 +954,14 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-	if (list_empty (&ready_list))	return idle_thread;
- 	else return list_entry(list_pop_front(&ready_list),struct thread,elem);
+  int priority = ready_max_priority ();
+  struct thread *t;
+
+  if (priority < PRI_MIN)
+    return idle_thread;
+  t = list_entry (list_front (&ready_queues[priority]), struct thread, elem);
+  ready_remove (t);
+  return t;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -788,9 +987,34 @@ thread_schedule_tail (struct thread *prev)
  
   ASSERT (intr_get_level () == INTR_OFF);
 
-  /* Mark us as running. */
+  /* Mark us as running, and account for the time we spent
+     ready. */
+  if (prev != NULL && cur->status == THREAD_READY)
+    {
+      int64_t now = timer_ns ();
+      int64_t waited = now - cur->sched_since;
+
+      cur->sched.ready_ns += waited;
+      if (cur->sched_woken)
+        {
+          int64_t us = waited / 1000;
+          int bucket = 0;
+
+          while (us != 0 && bucket < SCHEDLAT_CNT - 1)
+            {
+              us >>= 1;
+              bucket++;
+            }
+          sched_latency.buckets[bucket]++;
+          cur->sched_woken = false;
+        }
+      cur->sched_since = now;
+    }
   cur->status = THREAD_RUNNING;
 
+  /* A context switch is where RCU grace periods advance. */
+  rcu_quiescent ();
+
   /* Start new time slice. */
   thread_ticks = 0;
 
@@ -807,7 +1031,7 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      thread_page_put (prev);
     }
 }
 
@@ -829,11 +1053,65 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  if (cur == idle_thread && next != idle_thread)
+    timer_idle_exit ();
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      /* Close CUR's running interval.  A thread that gives up the
+         CPU while still runnable was preempted or yielded; one
+         that blocks or exits gave it up voluntarily. */
+      int64_t now = timer_ns ();
+
+      cur->sched.run_ns += now - cur->sched_since;
+      cur->sched_since = now;
+      if (cur->status == THREAD_READY)
+        cur->sched.involuntary++;
+      else
+        cur->sched.voluntary++;
+
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev); 
 }
 
+/* Returns a page for a new thread, from the cache of exited
+   threads' pages if possible, or a null pointer if memory is
+   exhausted.  The page is not zeroed: init_thread() clears the
+   struct thread at its base, and the stack above needs no
+   initialization. */
+static void *
+thread_page_get (void)
+{
+  enum intr_level old_level = intr_disable ();
+  void *page = thread_page_cache;
+
+  if (page != NULL)
+    {
+      thread_page_cache = *(void **) page;
+      thread_page_cache_cnt--;
+    }
+  intr_set_level (old_level);
+
+  return page != NULL ? page : palloc_get_page (0);
+}
+
+/* Releases the page of exited thread PAGE, keeping it for reuse
+   unless the cache is full.  Interrupts must be off. */
+static void
+thread_page_put (void *page)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_page_cache_cnt < THREAD_PAGE_CACHE_MAX)
+    {
+      *(void **) page = thread_page_cache;
+      thread_page_cache = page;
+      thread_page_cache_cnt++;
+    }
+  else
+    palloc_free_page (page);
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) 
@@ -856,17 +1134,21 @@ struct thread*
 getThreadFromTid(tid_t tid)
 
 {
-	struct list_elem *e = list_begin(&all_list);
+	struct list *bucket = tid_bucket (tid);
 	struct thread *result = NULL;
-	for(;e!=list_end(&all_list);e=list_next(e))
+	enum intr_level old_level = intr_disable();
+	struct list_elem *e;
+
+	for(e = list_begin(bucket);e!=list_end(bucket);e=list_next(e))
 	{
-		struct thread *t = list_entry(e,struct thread,allelem);
+		struct thread *t = list_entry(e,struct thread,tidelem);
 		if(tid == t->tid)
 		{
 			result = t;
 			break;
 		}
 	}
+	intr_set_level(old_level);
 	return result;
 }
 
@@ -928,20 +1210,6 @@ int divxn(int x, int n)
 	return x/n;
 }
 
-struct child_info*  
-getCIFromTid(tid_t tid)
-{
-	struct list_elem *e;
-	struct child_info *ci;
-	for(e = list_begin(&child_info_list);e != list_end(&child_info_list);e = list_next(e))
-	{
-		ci = list_entry(e,struct child_info,elem);
-		if (ci->tid == tid)
-			return ci;
-	}
-	return NULL;
-}
-
 bool checkIsThread(char* filename)
 {
 	struct list_elem *e;
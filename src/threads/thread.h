@@ -2,9 +2,15 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
+#include <schedstat.h>
 #include <stdint.h>
 #include "threads/synch.h"
+
+/* Maximum number of rwlocks a thread may hold at once. */
+#define RWLOCK_HOLD_MAX 4
+
 /* States in a thread's life cycle. */
 enum thread_status
   {
@@ -79,10 +85,11 @@ struct thread;
    value, triggering the assertion. */
 /* The `elem' member has a dual purpose.  It can be an element in
    the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   semaphore wait list (synch.c), or the sleep list (timer.c).
+   It can be used these ways only because they are mutually
+   exclusive: only a thread in the ready state is on the run
+   queue, whereas only a thread in the blocked state is on a
+   semaphore wait list or the sleep list, and never both. */
 
 struct thread
   {
@@ -93,9 +100,12 @@ struct thread
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct list_elem tidelem;           /* List element in tid hash bucket. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct list *wait_list;             /* Priority-ordered list that elem
+                                           is on while blocked, if any. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
@@ -108,7 +118,10 @@ struct thread
 		/* ----- for me ---- */
 	
 		int oPriority;		// original priority
-		struct list donate_list;	// donate_list
+		struct list held_locks;	// locks held, for priority donation
+		struct lock *wait_on_lock;	// lock being waited for, if any
+		struct rwlock_hold rwlock_holds[RWLOCK_HOLD_MAX];	// rwlocks held
+		struct rwlock *wait_on_rwlock;	// rwlock being waited for, if any
 
 		int nice;			// niceness
 		int recent_cpu;	// fixed_point format
@@ -116,19 +129,27 @@ struct thread
 		// project2
 		struct child_info *Info;
 		struct file* e_file;
-};
+		struct list children;	// child_info of each child process
 
-struct donate
-{
-	struct list_elem elem;
-	struct lock *l;
-	struct thread *donator;
+    /* Owned by devices/timer.c. */
+    int64_t wakeup_tick;                /* Tick to wake up at, while in
+                                           timer_sleep(). */
+
+    /* Owned by threads/rcu.c. */
+    int rcu_nesting;                    /* Depth of rcu_read_lock() calls. */
+    unsigned rcu_epoch;                 /* RCU epoch of outermost call. */
+
+    /* Scheduler statistics, owned by thread.c. */
+    struct schedstat sched;             /* Counters reported to users. */
+    int64_t sched_since;                /* timer_ns() at last state change. */
+    bool sched_woken;                   /* Readied by thread_unblock()? */
 };
 
 struct child_info
 {
 	struct thread *parent;
-	struct list_elem elem;
+	struct list_elem elem;	// element in parent's children list
+	struct hash_elem hash_elem;	// element in child_info table, by tid
 	struct semaphore w_sema;
 	struct semaphore e_sema;
 	tid_t tid;
@@ -149,11 +170,15 @@ void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+void thread_idle_ticks (int64_t);
+void thread_get_schedstat (struct thread *, struct schedstat *);
+void thread_get_schedlat (struct schedlat *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_block (void);
+void thread_block_on (struct list *);
 void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
@@ -180,11 +205,11 @@ int thread_get_load_avg (void);
 bool compare_pri(const struct list_elem *e1, const struct list_elem *e2, void *aux UNUSED);
 
 void inc_recent_cpu(void);
-void recalc_pri(void);
 void recalc_load(void);
 void recalc_cpu(void);
 int getReadyThread(void);
-int search_best_donator(struct list *dl);
+void thread_donate_priority(struct thread *);
+void thread_refresh_priority(void);
 int mlfqs_calc_pri(struct thread* t);
 
 // project2
@@ -0,0 +1,263 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Kernel work queue.
+
+   Work items are run, in priority order, by a small pool of
+   kernel worker threads.  Queuing an item that is already queued
+   does nothing, so repeated requests for the same work before it
+   gets to run are coalesced into one run.  An item may also be
+   queued to run after a delay, in timer ticks; the timer
+   interrupt moves it to the ready queue when it falls due.
+
+   Queuing and canceling only turn interrupts off briefly and
+   never sleep, so interrupt handlers can use them to push work
+   out of interrupt context.
+
+   A worker waits for work at PRI_MAX, so that it takes a newly
+   queued item promptly, and then runs the item at the item's own
+   priority.  An item that runs long at low priority occupies its
+   worker for that long, so more urgent work needs another worker
+   to run right away. */
+
+/* Default and largest number of worker threads. */
+#define WORKQUEUE_DEFAULT 2
+#define WORKQUEUE_MAX 8
+
+unsigned workqueue_threads = WORKQUEUE_DEFAULT;
+
+/* Items ready to run, highest priority first. */
+static struct list ready_queue = LIST_INITIALIZER (ready_queue);
+
+/* Delayed items, earliest due first. */
+static struct list delayed_queue = LIST_INITIALIZER (delayed_queue);
+
+/* Counts the items on ready_queue, for the workers to wait on. */
+static struct semaphore ready_sema;
+
+static thread_func worker;
+
+/* Starts the worker threads.  Must be called after
+   thread_start() and before any work is queued. */
+void
+workqueue_init (void)
+{
+  unsigned i;
+
+  sema_init (&ready_sema, 0);
+  if (workqueue_threads < 1)
+    workqueue_threads = 1;
+  if (workqueue_threads > WORKQUEUE_MAX)
+    workqueue_threads = WORKQUEUE_MAX;
+  for (i = 0; i < workqueue_threads; i++)
+    {
+      char name[24];
+
+      snprintf (name, sizeof name, "kworker%u", i);
+      thread_create (name, PRI_MAX, worker, NULL);
+    }
+}
+
+/* Initializes W to run FUNC at PRIORITY each time it is
+   queued. */
+void
+work_init (struct work *w, work_func *func, int priority)
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+  ASSERT (priority >= PRI_MIN && priority <= PRI_MAX);
+
+  w->func = func;
+  w->priority = priority;
+  w->due = 0;
+  w->state = WORK_IDLE;
+}
+
+/* Returns true if work item A should run before B. */
+static bool
+runs_before (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED)
+{
+  const struct work *a = list_entry (a_, struct work, elem);
+  const struct work *b = list_entry (b_, struct work, elem);
+
+  return a->priority > b->priority;
+}
+
+/* Returns true if delayed work item A falls due before B. */
+static bool
+due_before (const struct list_elem *a_, const struct list_elem *b_,
+            void *aux UNUSED)
+{
+  const struct work *a = list_entry (a_, struct work, elem);
+  const struct work *b = list_entry (b_, struct work, elem);
+
+  return a->due < b->due;
+}
+
+/* Moves W, which must not be pending, to the ready queue.
+   Interrupts must be off. */
+static void
+make_ready (struct work *w)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (w->state == WORK_DELAYED)
+    list_remove (&w->elem);
+  w->state = WORK_PENDING;
+  list_insert_ordered (&ready_queue, &w->elem, runs_before, NULL);
+  sema_up (&ready_sema);
+}
+
+/* Queues W to run as soon as a worker is free.  If W is delayed,
+   it stops waiting and runs now.  Returns false if W was already
+   pending, in which case this request merges with that one.  W
+   may be queued again while it is running, in which case it runs
+   again afterward.
+
+   This function may be called from an interrupt handler. */
+bool
+work_queue (struct work *w)
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  if (w->state != WORK_PENDING)
+    {
+      make_ready (w);
+      queued = true;
+    }
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* Queues W to run TICKS timer ticks from now.  Returns false,
+   without changing when W runs, if W was already delayed or
+   pending.
+
+   This function may be called from an interrupt handler. */
+bool
+work_queue_delayed (struct work *w, int64_t ticks)
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  ASSERT (w != NULL);
+
+  if (ticks <= 0)
+    return work_queue (w);
+
+  old_level = intr_disable ();
+  if (w->state == WORK_IDLE)
+    {
+      w->state = WORK_DELAYED;
+      w->due = timer_ticks () + ticks;
+      list_insert_ordered (&delayed_queue, &w->elem, due_before, NULL);
+      queued = true;
+    }
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* Removes W from the queues, if it is queued.  Returns true if W
+   was queued.  Does not wait for a run of W already in progress
+   to finish.
+
+   This function may be called from an interrupt handler. */
+bool
+work_cancel (struct work *w)
+{
+  enum intr_level old_level;
+  bool canceled = false;
+
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  if (w->state != WORK_IDLE)
+    {
+      /* A pending item keeps its count in ready_sema; the worker
+         that takes that count finds one item fewer and goes
+         back to waiting. */
+      list_remove (&w->elem);
+      w->state = WORK_IDLE;
+      canceled = true;
+    }
+  intr_set_level (old_level);
+
+  return canceled;
+}
+
+/* Called from the timer interrupt handler at tick NOW.  Moves
+   the delayed items that have fallen due to the ready queue.
+   Returns true if any were moved. */
+bool
+workqueue_timer (int64_t now)
+{
+  bool moved = false;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!list_empty (&delayed_queue))
+    {
+      struct work *w = list_entry (list_front (&delayed_queue),
+                                   struct work, elem);
+      if (w->due > now)
+        break;
+      make_ready (w);
+      moved = true;
+    }
+  return moved;
+}
+
+/* Returns the timer tick at which the earliest delayed item
+   falls due, or INT64_MAX if there is none.  Interrupts must be
+   off. */
+int64_t
+workqueue_next_due (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (list_empty (&delayed_queue))
+    return INT64_MAX;
+  return list_entry (list_front (&delayed_queue), struct work, elem)->due;
+}
+
+/* Worker thread.  Runs ready items, highest priority first. */
+static void
+worker (void *aux UNUSED)
+{
+  for (;;)
+    {
+      enum intr_level old_level;
+      struct work *w = NULL;
+
+      sema_down (&ready_sema);
+
+      old_level = intr_disable ();
+      if (!list_empty (&ready_queue))
+        {
+          w = list_entry (list_pop_front (&ready_queue), struct work, elem);
+          w->state = WORK_IDLE;
+        }
+      intr_set_level (old_level);
+
+      if (w == NULL)
+        continue;
+
+      if (!thread_mlfqs)
+        thread_set_priority (w->priority);
+      w->func (w);
+      if (!thread_mlfqs)
+        thread_set_priority (PRI_MAX);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct work;
+
+/* Function run by a worker thread to do a piece of work. */
+typedef void work_func (struct work *);
+
+/* States of a work item. */
+enum work_state
+  {
+    WORK_IDLE,                  /* Not queued; may be running. */
+    WORK_DELAYED,               /* Waiting for its timer tick. */
+    WORK_PENDING                /* Waiting for a worker thread. */
+  };
+
+/* A deferred piece of work.  Usually embedded in the structure
+   that the work is about, and recovered in FUNC with
+   list_entry()-style pointer arithmetic. */
+struct work
+  {
+    struct list_elem elem;      /* In the ready or delayed queue. */
+    work_func *func;            /* Function to run. */
+    int priority;               /* Priority to run FUNC at. */
+    int64_t due;                /* Timer tick to queue at, if delayed. */
+    enum work_state state;      /* Current state. */
+  };
+
+/* Number of worker threads.  Controlled by the kernel
+   command-line option "-wq=N". */
+extern unsigned workqueue_threads;
+
+void workqueue_init (void);
+
+void work_init (struct work *, work_func *, int priority);
+bool work_queue (struct work *);
+bool work_queue_delayed (struct work *, int64_t ticks);
+bool work_cancel (struct work *);
+
+/* For devices/timer.c. */
+bool workqueue_timer (int64_t now);
+int64_t workqueue_next_due (void);
+
+#endif /* threads/workqueue.h */
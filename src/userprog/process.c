@@ -18,6 +18,7 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 
 static thread_func start_process NO_RETURN;
@@ -29,53 +30,98 @@ struct args_elem{
 	uint32_t stAddr;
 };
 
-static struct list args_list;
+static struct slab_cache args_elem_cache;
 
-static int process_argc;
 extern struct lock FILELOCK;
-extern struct list child_info_list;
 
+/* child_info of every child process, hashed by tid, so that the
+   process lifecycle calls can find one without a list scan.
+   Each child_info is also on its parent's children list, which
+   is how a parent frees its children's records on exit. */
+static struct hash child_info_table;
+static struct rwlock child_info_lock;
+static struct slab_cache child_info_cache;
+
+static unsigned
+child_info_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+	return hash_int (hash_entry (e, struct child_info, hash_elem)->tid);
+}
+
+static bool
+child_info_less (const struct hash_elem *a, const struct hash_elem *b,
+								 void *aux UNUSED)
+{
+	return hash_entry (a, struct child_info, hash_elem)->tid
+		< hash_entry (b, struct child_info, hash_elem)->tid;
+}
+
+/* Initializes the child_info table and the object caches.
+   Must be called after malloc_init(). */
+void
+process_init (void)
+{
+	if (!hash_init (&child_info_table, child_info_hash, child_info_less, NULL))
+		PANIC ("Failed to allocate child_info table");
+	rwlock_init (&child_info_lock);
+	slab_cache_init (&child_info_cache, "child_info", sizeof (struct child_info), NULL);
+	slab_cache_init (&args_elem_cache, "args_elem", sizeof (struct args_elem), NULL);
+}
+
+/* Returns the child_info of the process with TID, or a null
+   pointer if there is none, either because TID is not a user
+   process or because its parent has already exited. */
+struct child_info*  
+getCIFromTid(tid_t tid)
+{
+	struct child_info key;
+	struct hash_elem *e;
+
+	key.tid = tid;
+	rwlock_acquire_read (&child_info_lock);
+	e = hash_find (&child_info_table, &key.hash_elem);
+	rwlock_release_read (&child_info_lock);
+	return e != NULL ? hash_entry (e, struct child_info, hash_elem) : NULL;
+}
+
+/* Frees the args_elems in ARGS. */
 static void 
-allRemove(void)
+allRemove(struct list *args)
 {
-	struct list_elem *e;
-	for(e = list_begin(&args_list); e != list_end(&args_list); e=list_next(e))
+	while(!list_empty(args))
 	{
-		struct args_elem *ae = list_entry(e,struct args_elem,elem);
-		list_remove(e);
-		e = list_prev(e);
-		free(ae);
+		struct args_elem *ae = list_entry(list_pop_front(args),struct args_elem,elem);
+		slab_free(&args_elem_cache, ae);
 	}
 }
 
-static char *
-parseArgs(char* file_name)
+/* Splits CMD_LINE into words in place and appends an args_elem
+   for each to ARGS, which the caller owns, so that concurrent
+   execs never share argument state.  Returns the number of
+   words, or -1 if memory ran out. */
+static int
+parseArgs(char* cmd_line, struct list *args)
 {
-	//struct thread* cur = thread_current();
-	int len = strlen(file_name)+1;
-	char *file = (char *)malloc(sizeof(char)*len);
 	char *ptrptr;
 	char *token;
+	int argc = 0;
 
-	process_argc = 0;
-
-	list_init(&args_list);
+	list_init(args);
 
-	memset(file,'\0',len);
-	strlcpy(file,file_name,len);
-
-	token = strtok_r(file," ",&ptrptr);
-	file = token;
-
-	while(token != NULL)
+	for(token = strtok_r(cmd_line," ",&ptrptr); token != NULL;
+			token = strtok_r(NULL," ",&ptrptr))
 	{
-		process_argc++;
-		struct args_elem *em = (struct args_elem *)malloc(sizeof(struct args_elem));
+		struct args_elem *em = (struct args_elem *)slab_alloc(&args_elem_cache);
+		if(em == NULL)
+		{
+			allRemove(args);
+			return -1;
+		}
+		argc++;
 		em->addr = token;
-		list_push_back(&args_list,&em->elem);
-		token = strtok_r(NULL," ",&ptrptr);
+		list_push_back(args,&em->elem);
 	}
-	return file;
+	return argc;
 }
 
 /* Starts a new thread running a user program loaded from
@@ -95,30 +141,32 @@ process_execute (const char *file_name)
     return TID_ERROR;
  
 	strlcpy (fn_copy, file_name, PGSIZE);
-	
-	if(file_name == NULL)
-		return TID_ERROR;
 
-	int len = strlen(file_name)+1;
-	char* file = (char *)malloc(sizeof(char)*len);
-	memset(file,'\0',len);
-	strlcpy(file,file_name,len);
-	
-	file_name = parseArgs(file);
+	/* The thread is named after the program, the first word of
+	   FILE_NAME.  The child splits its own copy into arguments. */
+	char prog_name[16];
+	char *ptrptr;
+	while(*file_name == ' ')
+		file_name++;
+	strlcpy(prog_name, file_name, sizeof prog_name);
+	strtok_r(prog_name," ",&ptrptr);
 
   /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
+  tid = thread_create (prog_name, PRI_DEFAULT, start_process, fn_copy);
 	if (tid == TID_ERROR){
     palloc_free_page (fn_copy); 
 		return tid;
 	} 
 	
-	struct child_info *ci = (struct child_info *)malloc(sizeof (struct child_info));
+	struct child_info *ci = (struct child_info *)slab_alloc(&child_info_cache);
 	ci->tid = tid;
 	ci->parent = thread_current();
 	sema_init(&ci->w_sema,0);
 	sema_init(&ci->e_sema,0);
-	list_push_back(&child_info_list,&ci->elem);
+	list_push_back(&ci->parent->children,&ci->elem);
+	rwlock_acquire_write (&child_info_lock);
+	hash_insert (&child_info_table, &ci->hash_elem);
+	rwlock_release_write (&child_info_lock);
 	return tid;
 }
 
@@ -132,22 +180,25 @@ start_process (void *file_name_)
   char *file_name = file_name_;
   struct intr_frame if_;
   struct thread* cur = thread_current();
-	bool success;
-
-	char* ptrptr;
+	bool success = false;
+	struct list args;		/* Words of FILE_NAME, which they point into. */
+	int argc;
 
-	file_name = strtok_r(file_name," ",&ptrptr);						// recheck
+	argc = parseArgs(file_name, &args);
 
 	/* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-	success = load (file_name, &if_.eip, &if_.esp);
+	if(argc > 0)
+		success = load (list_entry(list_front(&args),struct args_elem,elem)->addr,
+										&if_.eip, &if_.esp);
   
 	/* If load failed, quit. */
   if (!success){
-	 	palloc_free_page (file_name);
+		allRemove(&args);
+	 	palloc_free_page (file_name_);
 		struct child_info * ci = getCIFromTid(cur->tid);
 
 		ci->alreadyWait = false;
@@ -156,10 +207,10 @@ start_process (void *file_name_)
 		thread_exit ();
 	}
 
-	struct list_elem *e = list_rbegin(&args_list);
+	struct list_elem *e = list_rbegin(&args);
 	struct args_elem *ae;
 
-	for(;e != list_head(&args_list);e = list_prev(e))
+	for(;e != list_head(&args);e = list_prev(e))
 	{
 		ae = list_entry(e,struct args_elem,elem);
 		if_.esp -= strlen(ae->addr)+1;
@@ -171,7 +222,7 @@ start_process (void *file_name_)
 	if_.esp -= align;
 	memset(if_.esp,'\x0',align);
 
-	for(e = list_rbegin(&args_list); e != list_head(&args_list);e = list_prev(e))
+	for(e = list_rbegin(&args); e != list_head(&args);e = list_prev(e))
 	{
 		ae = list_entry(e,struct args_elem,elem);
 		if_.esp -= 4;
@@ -181,14 +232,13 @@ start_process (void *file_name_)
 	if_.esp -= 4;
 	*(uint32_t*)if_.esp = (uint32_t)if_.esp+4; 		// argv
 	if_.esp -= 4;	
-	*(int*)if_.esp = (int)process_argc;			// argc
+	*(int*)if_.esp = argc;			// argc
 	if_.esp -= 4;
 
 	*(int*)if_.esp = (int)NULL;
 
-	palloc_free_page(file_name);
-
-	allRemove();
+	allRemove(&args);
+	palloc_free_page(file_name_);
 
   /* Start the user process by simulating a return from an
      interrupt, implemented by intr_exit (in
@@ -218,25 +268,12 @@ start_process (void *file_name_)
    does nothing. */
 
 	
-static bool checkChild(tid_t tid)
-{
-	struct list_elem *e;
-	struct child_info *ci;
-	for(e = list_begin(&child_info_list);e!=list_end(&child_info_list);e=list_next(e))
-	{
-		ci = list_entry(e,struct child_info,elem);
-		if(ci->tid == tid && thread_current() == ci->parent)
-			return true;
-	}
-	return false;
-}
-
 int
 process_wait (tid_t child_tid) 
 {
 	struct child_info *ci = getCIFromTid(child_tid);
 
-	if(!checkChild(child_tid))
+	if(ci == NULL || ci->parent != thread_current())
 	{
 		return -1;
 	}
@@ -258,17 +295,14 @@ process_wait (tid_t child_tid)
 static void
 remove_ci(struct thread *cur)
 {
-	struct list_elem *e;
-	struct child_info *ci;
-	for(e = list_begin(&child_info_list); e != list_end(&child_info_list); e = list_next(e))
+	while (!list_empty (&cur->children))
 	{
-		ci = list_entry(e,struct child_info,elem);
-		if(ci->parent == cur)
-		{
-			list_remove(e);
-			e=list_prev(e);
-			free(ci);
-		}
+		struct child_info *ci = list_entry (list_pop_front (&cur->children),
+																				struct child_info, elem);
+		rwlock_acquire_write (&child_info_lock);
+		hash_delete (&child_info_table, &ci->hash_elem);
+		rwlock_release_write (&child_info_lock);
+		slab_free(&child_info_cache, ci);
 	}
 }
 
@@ -296,7 +330,8 @@ process_exit (void)
     }
 	
 	struct child_info *ci = getCIFromTid(cur->tid);
-	sema_up(&ci->w_sema);
+	if(ci != NULL)
+		sema_up(&ci->w_sema);
 
 	remove_ci(cur);
 }
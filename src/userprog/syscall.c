@@ -5,16 +5,18 @@
 #include "threads/thread.h"
 #include "threads/init.h"
 #include <string.h>
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 #include "filesys/file.h"
 #include "devices/input.h"
+#include "devices/timer.h"
 
 #define checkARG 	if((uint32_t)esp > 0xc0000000-(argsNum+1)*4) \
 										syscall_exit(f,argsNum);
 
 static void syscall_handler (struct intr_frame *);
 static struct list fd_list;
+static struct slab_cache fd_elem_cache;
 
 struct lock FILELOCK;
 
@@ -31,21 +33,36 @@ int currentFd(struct thread *cur)
 	return result;
 }
 
+/* Frees an fd_elem once no lookup can still be looking at it. */
+static void
+free_fd_elem (struct rcu_head *head)
+{
+	slab_free (&fd_elem_cache, rcu_entry (head, struct fd_elem, rcu));
+}
+
+/* Returns the file that CUR, which must be the running thread,
+   has open as FD, or a null pointer.
+   Needs no lock.  Other threads add and remove their own entries
+   under FILELOCK while we walk fd_list, and RCU keeps a removed
+   entry alive until we are done with it.  Only CUR closes CUR's
+   files, so the file returned stays open until CUR closes it.
+   Operating on the file still needs FILELOCK. */
 struct file* getFile(int fd, struct thread *cur)
 {
-	struct list_elem *e = list_begin(&fd_list);
+	struct list_elem *e;
 	struct file* result = NULL;
-	for(;e!=list_end(&fd_list);e=list_next(e))
+	ASSERT(cur == thread_current());
+	rcu_read_lock();
+	for(e = list_begin(&fd_list);e!=list_end(&fd_list);e=list_next(e))
 	{
 		struct fd_elem *fe = list_entry(e,struct fd_elem, elem);
 		if(fe->owner == cur && fe->fd == fd)
 		{
 			result = fe->file;
-			if(fe->isEXE)
-				file_deny_write(fe->file);
 			break;
 		}
 	}
+	rcu_read_unlock();
 	return result;
 }
 
@@ -54,7 +71,8 @@ syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 	list_init(&fd_list);
-	lock_init(&FILELOCK);
+	lock_init_named(&FILELOCK, "FILELOCK");
+	slab_cache_init(&fd_elem_cache, "fd_elem", sizeof(struct fd_elem), NULL);
 }
 
 static void
@@ -89,6 +107,14 @@ syscall_handler (struct intr_frame *f)
 									 break;
 		case SYS_CLOSE: syscall_close(f,1);                  /* Close a file. */
 										break;
+		case SYS_FSYNC: syscall_fsync(f,1);                  /* Make a file's data durable. */
+										break;
+		case SYS_CLOCK: syscall_clock(f,1);                  /* Read the monotonic clock. */
+										break;
+		case SYS_SCHEDSTAT: syscall_schedstat(f,2);          /* Read a thread's scheduler statistics. */
+										break;
+		case SYS_SCHEDLAT: syscall_schedlat(f,1);            /* Read the scheduling latency histogram. */
+										break;
 	}	
 }
 
@@ -109,7 +135,7 @@ void allClose(struct thread *cur)
 			file_close(fe->file);
 			list_remove(e);	
 			e=list_prev(e);
-			free(fe);
+			call_rcu(&fe->rcu, free_fd_elem);
 
 		}
 	}
@@ -249,7 +275,7 @@ void syscall_open(struct intr_frame *f,int argsNum){
 	struct file* file = filesys_open(filename);
 
 	if(file != NULL){
-		struct fd_elem *fe = (struct fd_elem *)malloc(sizeof(struct fd_elem));
+		struct fd_elem *fe = (struct fd_elem *)slab_alloc(&fd_elem_cache);
 	
 		fe->owner = cur;
 		fe->file = file;
@@ -258,9 +284,10 @@ void syscall_open(struct intr_frame *f,int argsNum){
 		if(checkIsThread(filename))
 		{
 			fe->isEXE = true;
+			file_deny_write(file);
 		} else fe->isEXE = false;
 
-		list_push_back(&fd_list,&fe->elem);
+		rcu_list_push_back(&fd_list,&fe->elem);
 		
 		f->eax = fe->fd;
 	} else f->eax = -1;
@@ -274,12 +301,14 @@ void syscall_filesize(struct intr_frame *f,int argsNum){
 	
 	int fd = *(int *)(esp+4);
 
-	lock_acquire(&FILELOCK);
 	struct file *file = getFile(fd,thread_current());
 	if(file != NULL)
+	{
+		lock_acquire(&FILELOCK);
 		f->eax = file_length(file);
+		lock_release(&FILELOCK);
+	}
 	else f->eax = -1;
-	lock_release(&FILELOCK);
 }
 
 void syscall_read(struct intr_frame *f,int argsNum){
@@ -293,7 +322,6 @@ void syscall_read(struct intr_frame *f,int argsNum){
 	
 	if(buffer>(unsigned int)0xc0000000) syscall_exit(f,-1);
 	
-	lock_acquire(&FILELOCK);
 	if(fd == 0){
 		uint32_t i;
 		for(i = 0; i < size; i++)
@@ -307,13 +335,14 @@ void syscall_read(struct intr_frame *f,int argsNum){
 		struct file *file = getFile(fd,thread_current());
 		if (file != NULL)
 		{
+			lock_acquire(&FILELOCK);
 			if(file_tell(file) >= file_length(file))
 				f->eax = 0;
 			else f->eax = file_read(file,buffer,size);
+			lock_release(&FILELOCK);
 		}
 		else f->eax = -1;
 	}
-	lock_release(&FILELOCK);
 }
 
 void syscall_write (struct intr_frame *f,int argsNum)
@@ -325,7 +354,6 @@ void syscall_write (struct intr_frame *f,int argsNum)
 	int fd = *(int *)(esp+4);
 	char* buffer = *(char **)(esp+8);
 	uint32_t size = *(uint32_t *)(esp+12);
-	lock_acquire(&FILELOCK);
 	if (fd == 1)
 	{
 		putbuf((char *)buffer,size);
@@ -336,13 +364,14 @@ void syscall_write (struct intr_frame *f,int argsNum)
 		struct file *file = getFile(fd,thread_current());
 		if (file != NULL)
 		{
+			lock_acquire(&FILELOCK);
 			if(file_tell(file) >= file_length(file))	// EOF
 				f->eax = 0;
 			else f->eax = file_write(file,buffer,size);
+			lock_release(&FILELOCK);
 		}
 		else f->eax = -1;
 	}
-	lock_release(&FILELOCK);
 }
 
 
@@ -354,14 +383,13 @@ void syscall_seek(struct intr_frame *f,int argsNum){
 	int fd = *(int *)(esp+4);
 	uint32_t position = *(uint32_t *)(esp+8);
 
-	lock_acquire(&FILELOCK);
+	/* The position belongs to this process's file alone, so no
+	   lock is needed. */
 	struct file *file = getFile(fd,thread_current());
 	if(file != NULL)
 	{
 		file_seek(file,position);		
 	}
-
-	lock_release(&FILELOCK);
 }
 void syscall_tell(struct intr_frame *f,int argsNum){
 	void*esp = f->esp;
@@ -369,13 +397,11 @@ void syscall_tell(struct intr_frame *f,int argsNum){
 
 	int fd = *(int *)(esp+4);
 
-	lock_acquire(&FILELOCK);
 	struct file *file = getFile(fd,thread_current());
 	if(file != NULL)
 	{
 		f->eax = file_tell(file);
 	} else f->eax = -1;
-	lock_release(&FILELOCK);
 	
 }
 
@@ -388,7 +414,7 @@ void elemFile(struct file *file)
 		if(fe->file == file && fe->owner == thread_current())
 		{
 			list_remove(e);
-			free(fe);
+			call_rcu(&fe->rcu, free_fd_elem);
 			return;
 		}
 	}
@@ -412,3 +438,75 @@ void syscall_close(struct intr_frame *f,int argsNum){
 	lock_release(&FILELOCK);
 }
 
+/* Writes the file open as fd back to disk and flushes the disk's
+   write cache, so that data written before the call survives a
+   crash.  Returns false for a bad fd or the console. */
+void syscall_fsync(struct intr_frame *f,int argsNum){
+	void*esp = f->esp;
+	checkARG
+
+	int fd = *(int *)(esp+4);
+
+	struct file *file = getFile(fd,thread_current());
+	if(file != NULL)
+	{
+		lock_acquire(&FILELOCK);
+		file_sync(file);
+		lock_release(&FILELOCK);
+		f->eax = true;
+	} else f->eax = false;
+}
+
+/* Stores the nanoseconds since boot, from the TSC clock, in the
+   int64_t that the argument points to. */
+void syscall_clock(struct intr_frame *f,int argsNum){
+	void*esp = f->esp;
+	checkARG
+
+	int64_t *ns = *(int64_t **)(esp+4);
+
+	if(ns == NULL || (uint32_t)ns > 0xc0000000-sizeof *ns) syscall_exit(f,-1);
+
+	*ns = timer_ns();
+}
+
+/* Copies the scheduler statistics of the thread with the given
+   pid, or of the caller if pid is 0, to user memory.  Returns
+   false if there is no such thread. */
+void syscall_schedstat(struct intr_frame *f,int argsNum){
+	void*esp = f->esp;
+	checkARG
+
+	tid_t tid = *(tid_t *)(esp+4);
+	struct schedstat *stats = *(struct schedstat **)(esp+8);
+	struct schedstat copy;
+	struct thread *t;
+
+	if(stats == NULL || (uint32_t)stats > 0xc0000000-sizeof *stats) syscall_exit(f,-1);
+
+	enum intr_level old_level = intr_disable();
+	t = tid == 0 ? thread_current() : getThreadFromTid(tid);
+	if(t != NULL)
+		thread_get_schedstat(t,&copy);
+	intr_set_level(old_level);
+
+	if(t != NULL)
+	{
+		*stats = copy;
+		f->eax = true;
+	} else f->eax = false;
+}
+
+/* Copies the scheduling latency histogram to user memory. */
+void syscall_schedlat(struct intr_frame *f,int argsNum){
+	void*esp = f->esp;
+	checkARG
+
+	struct schedlat *lat = *(struct schedlat **)(esp+4);
+	struct schedlat copy;
+
+	if(lat == NULL || (uint32_t)lat > 0xc0000000-sizeof *lat) syscall_exit(f,-1);
+
+	thread_get_schedlat(&copy);
+	*lat = copy;
+}
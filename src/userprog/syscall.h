@@ -3,6 +3,7 @@
 
 #include "threads/interrupt.h"
 #include "filesys/filesys.h"
+#include "threads/rcu.h"
 #include "threads/thread.h"
 
 void syscall_init (void);
@@ -33,6 +34,14 @@ void syscall_tell(struct intr_frame *f,int argsNum);
 
 void syscall_close(struct intr_frame *f,int argsNum);
 
+void syscall_fsync(struct intr_frame *f,int argsNum);
+
+void syscall_clock(struct intr_frame *f,int argsNum);
+
+void syscall_schedstat(struct intr_frame *f,int argsNum);
+
+void syscall_schedlat(struct intr_frame *f,int argsNum);
+
 int currentFd(struct thread *cur);
 
 struct file* getFile(int fd,struct thread *cur);
@@ -41,8 +50,11 @@ void elemFile(struct file *file);
 
 void allClose(struct thread *cur);
 
+/* An open file descriptor.  Lookups walk fd_list inside an RCU
+   read section, so a closed fd_elem is freed through call_rcu(). */
 struct fd_elem{
 	struct list_elem elem;
+	struct rcu_head rcu;
 	struct thread* owner;
 	struct file *file;
 	char* filename;